@@ -0,0 +1,90 @@
+#include <bench.h>
+#include <scenes.h>
+#include <cpu/raymarcher.h>
+#include <engine/baked_field.h>
+
+namespace bench {
+    namespace {
+        // Marks every top level object static, folders are walked into
+        void make_static(Object &object) {
+            for (Object &child: object.children) {
+                if (child.obj_type == ObjectType::Empty) make_static(child);
+                else child.is_static = true;
+            }
+        }
+
+        // First static object, folders are walked into like make_static() does
+        Object *find_static(Object &object) {
+            for (Object &child: object.children) {
+                if (child.is_static) return &child;
+                if (child.obj_type != ObjectType::Empty) continue;
+                if (Object *found = find_static(child)) return found;
+            }
+            return nullptr;
+        }
+    }
+
+    void baked_field(Reporter &reporter) {
+        constexpr uint32_t width = 320;
+        constexpr uint32_t height = 180;
+
+        cpu::ThreadPool pool;
+        const cpu::Raymarcher raymarcher(pool, cpu::Raymarcher::Traversal::SingleRay);
+
+        std::vector<NamedScene> scenes = standard_scenes();
+        scenes.push_back({"grid_1000", object_grid(1000)});
+
+        for (auto &[name, scene]: scenes) {
+            make_static(scene.root);
+
+            std::expected<SdfProgram, Err> program = compile_scene(scene.root);
+            if (!program) continue;
+
+            BakedField field;
+            if (!field.update(*program)) continue;
+
+            const double bake_ns = time_ns([&] {
+                BakedField fresh;
+                fresh.update(*program);
+            });
+
+            // Nudging one object back and forth only re-bakes the cells around it
+            Object *const edited = find_static(scene.root);
+
+            // Scenes without any static object have nothing to nudge
+            double rebake_ns = -1;
+            if (edited) {
+                float offset = 0.25f;
+                rebake_ns = time_ns([&] {
+                    edited->pos.y += offset;
+                    offset = -offset;
+                    const std::expected<SdfProgram, Err> moved = compile_scene(scene.root);
+                    field.update(*moved);
+                });
+            }
+
+            Image image(width, height);
+            const double analytic_ns = time_ns([&] { raymarcher.render(scene, image); },
+                                               std::chrono::milliseconds(1000));
+            const double analytic_steps = static_cast<double>(raymarcher.num_steps());
+
+            const double baked_ns = time_ns([&] { raymarcher.render(scene, image, &field); },
+                                            std::chrono::milliseconds(1000));
+            const double baked_steps = static_cast<double>(raymarcher.num_steps());
+
+            const double analytic_rate = analytic_steps / analytic_ns * 1e3;
+            const double baked_rate = baked_steps / baked_ns * 1e3;
+
+            const BakedField::Stats &stats = field.stats();
+            reporter.add("baked", name, "bricks", static_cast<double>(stats.num_bricks), "bricks");
+            reporter.add("baked", name, "memory", static_cast<double>(stats.memory_bytes) / (1024.0 * 1024.0), "MB");
+            reporter.add("baked", name, "full_bake", bake_ns / 1e6, "ms");
+            if (rebake_ns >= 0) reporter.add("baked", name, "rebake_one", rebake_ns / 1e6, "ms");
+            reporter.add("baked", name, "analytic_render", analytic_ns / 1e6, "ms");
+            reporter.add("baked", name, "baked_render", baked_ns / 1e6, "ms");
+            reporter.add("baked", name, "analytic_steps", analytic_rate, "Msteps/s");
+            reporter.add("baked", name, "baked_steps", baked_rate, "Msteps/s");
+            reporter.add("baked", name, "speedup", baked_rate / analytic_rate, "x");
+        }
+    }
+}
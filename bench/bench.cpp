@@ -0,0 +1,42 @@
+#include <bench.h>
+
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+namespace bench {
+    void Reporter::add(const std::string &suite, const std::string &name, const std::string &variant,
+                       const double value, const std::string &unit) {
+        results.push_back({suite, name, variant, value, unit});
+        std::cout << std::format("{:<12} {:<28} {:<14} {:>14.3f} {}", suite, name, variant, value, unit)
+                  << std::endl;
+    }
+
+    Err Reporter::write_json(const std::filesystem::path &path) const {
+        std::ofstream file(path);
+        if (!file.is_open()) return Err("Failed to open {} for the results.", path.string());
+
+        // Names are plain identifiers, nothing needs escaping. JSON has no NaN or infinity, ratios over a zero time
+        // are written as null.
+        file << "[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result &result = results[i];
+            const std::string value = std::isfinite(result.value) ? std::format("{}", result.value) : "null";
+            file << std::format(R"(  {{"suite": "{}", "name": "{}", "variant": "{}", "value": {}, "unit": "{}"}}{})",
+                                result.suite, result.name, result.variant, value, result.unit,
+                                i + 1 < results.size() ? ",\n" : "\n");
+        }
+        file << "]\n";
+
+        if (file.fail()) return Err("Failed to write the results to {}.", path.string());
+        return {};
+    }
+
+    void keep(const float val) {
+        // Volatile accesses cannot be optimized away, so neither can computing val
+        static volatile float sink;
+        sink = val;
+        static_cast<void>(sink);
+    }
+}
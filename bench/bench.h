@@ -0,0 +1,74 @@
+#ifndef RAYMARCHER_BENCH_H
+#define RAYMARCHER_BENCH_H
+
+#include <utils/err.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace bench {
+    struct Result {
+        std::string suite;
+        std::string name;
+        std::string variant;
+        double value;
+        std::string unit;
+    };
+
+    class Reporter {
+        std::vector<Result> results;
+
+    public:
+        // Records a result and prints it as it comes in
+        void add(const std::string &suite, const std::string &name, const std::string &variant, double value,
+                 const std::string &unit);
+
+        [[nodiscard]] const std::vector<Result> &all() const { return results; }
+
+        // Every result as a JSON array of objects with the Result's fields, for tracking runs over time
+        Err write_json(const std::filesystem::path &path) const;
+    };
+
+    // Keeps the compiler from discarding a computed value
+    void keep(float val);
+
+    // Calls fn() repeatedly until min_duration has passed and returns the mean time of one call in nanoseconds
+    template<typename Fn>
+    double time_ns(const Fn &fn, const std::chrono::milliseconds min_duration = std::chrono::milliseconds(200)) {
+        using clock = std::chrono::steady_clock;
+
+        // Warm up caches and lazily initialized state
+        fn();
+
+        size_t iterations = 1;
+        while (true) {
+            const clock::time_point start = clock::now();
+            for (size_t i = 0; i < iterations; ++i) fn();
+            const clock::duration elapsed = clock::now() - start;
+
+            if (elapsed >= min_duration) {
+                return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+            }
+            iterations *= 2;
+        }
+    }
+
+    // Suites
+    void sdf_primitives(Reporter &reporter);
+
+    void ray_packets(Reporter &reporter);
+
+    void bvh(Reporter &reporter);
+
+    void baked_field(Reporter &reporter);
+
+    void relaxed_marching(Reporter &reporter);
+
+    void buffer_io(Reporter &reporter);
+
+    void serialization(Reporter &reporter);
+}
+
+#endif //RAYMARCHER_BENCH_H
@@ -0,0 +1,81 @@
+#include <bench.h>
+#include <utils/buf.h>
+
+#include <glm/glm.hpp>
+
+#include <format>
+#include <string>
+
+namespace bench {
+    void buffer_io(Reporter &reporter) {
+        // Fields per record, written and read back as one variadic call or one call per field
+        constexpr size_t num_records = 4096;
+        constexpr double num_fields = 3.0 * num_records;
+
+        Buffer buffer;
+        const glm::vec3 vec(1, 2, 3);
+
+        const double write_variadic_ns = time_ns([&] {
+            buffer.reset();
+            for (uint32_t i = 0; i < num_records; ++i) buffer.write(i, 0.5f, vec);
+            keep(static_cast<float>(buffer.size()));
+        });
+
+        const double write_single_ns = time_ns([&] {
+            buffer.reset();
+            for (uint32_t i = 0; i < num_records; ++i) {
+                buffer.write(i);
+                buffer.write(0.5f);
+                buffer.write(vec);
+            }
+            keep(static_cast<float>(buffer.size()));
+        });
+
+        uint32_t u = 0;
+        float f = 0;
+        glm::vec3 v{};
+        const double read_variadic_ns = time_ns([&] {
+            buffer.rewind();
+            for (size_t i = 0; i < num_records; ++i) buffer.read(u, f, v);
+            keep(f + v.x + static_cast<float>(u));
+        });
+
+        const double read_single_ns = time_ns([&] {
+            buffer.rewind();
+            for (size_t i = 0; i < num_records; ++i) {
+                buffer.read(u);
+                buffer.read(f);
+                buffer.read(v);
+            }
+            keep(f + v.x + static_cast<float>(u));
+        });
+
+        reporter.add("buffer", "fields", "write_variadic", write_variadic_ns / num_fields, "ns/field");
+        reporter.add("buffer", "fields", "write_single", write_single_ns / num_fields, "ns/field");
+        reporter.add("buffer", "fields", "read_variadic", read_variadic_ns / num_fields, "ns/field");
+        reporter.add("buffer", "fields", "read_single", read_single_ns / num_fields, "ns/field");
+
+        // Length prefixed strings, as object names are stored
+        constexpr size_t num_strings = 1024;
+        for (const size_t length: {8, 64, 1024}) {
+            const std::string str(length, 'x');
+            const std::string name = std::format("string_{}", length);
+
+            const double write_ns = time_ns([&] {
+                buffer.reset();
+                for (size_t i = 0; i < num_strings; ++i) buffer.write(str);
+                keep(static_cast<float>(buffer.size()));
+            });
+
+            std::string read_str;
+            const double read_ns = time_ns([&] {
+                buffer.rewind();
+                for (size_t i = 0; i < num_strings; ++i) buffer.read(read_str);
+                keep(static_cast<float>(read_str.size()));
+            });
+
+            reporter.add("buffer", name, "write", write_ns / num_strings, "ns/string");
+            reporter.add("buffer", name, "read", read_ns / num_strings, "ns/string");
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#include <bench.h>
+#include <scenes.h>
+#include <cpu/raymarcher.h>
+#include <engine/bvh.h>
+
+#include <format>
+
+namespace bench {
+    void bvh(Reporter &reporter) {
+        constexpr uint32_t width = 320;
+        constexpr uint32_t height = 180;
+
+        cpu::ThreadPool pool;
+        const cpu::Raymarcher raymarcher(pool);
+
+        for (const size_t count: {100, 1000, 5000}) {
+            Scene scene = object_grid(count);
+            const std::string name = std::format("{}_objects", count);
+
+            const std::expected<SdfProgram, Err> program = compile_scene(scene.root);
+            if (!program) continue;
+
+            const double build_ns = time_ns([&] {
+                SceneBvh bvh;
+                bvh.update(*program);
+                keep(static_cast<float>(bvh.nodes.size()));
+            });
+
+            // Nothing moves between updates, so every update after the first is a refit
+            SceneBvh bvh;
+            bvh.update(*program);
+            const double refit_ns = time_ns([&] { bvh.update(*program); });
+
+            Image image(width, height);
+            const double render_ns = time_ns([&] { raymarcher.render(scene, image); },
+                                             std::chrono::milliseconds(1000));
+
+            reporter.add("bvh", name, "nodes", static_cast<double>(bvh.nodes.size()), "nodes");
+            reporter.add("bvh", name, "build", build_ns / 1e3, "us");
+            reporter.add("bvh", name, "refit", refit_ns / 1e3, "us");
+            reporter.add("bvh", name, "cpu_render", render_ns / 1e6, "ms");
+        }
+    }
+}
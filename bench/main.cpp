@@ -0,0 +1,63 @@
+#include <bench.h>
+
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Usage: raymarcher-bench [--json path] [suite...]. Runs every suite when none are given, and writes the results to
+// path as JSON when it is given. Exits with 1 on bad arguments without running anything.
+int main(int argc, char **argv) {
+    constexpr std::string_view usage = "Usage: raymarcher-bench [--json path] [suite...]";
+
+    const std::vector<std::pair<std::string_view, std::function<void(bench::Reporter &)>>> suites = {
+            {"sdf",       bench::sdf_primitives},
+            {"packets",   bench::ray_packets},
+            {"bvh",       bench::bvh},
+            {"baked",     bench::baked_field},
+            {"relaxed",   bench::relaxed_marching},
+            {"buffer",    bench::buffer_io},
+            {"serialize", bench::serialization},
+    };
+
+    std::vector<std::string_view> selected;
+    std::string_view json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg != "--json") {
+            selected.push_back(arg);
+        } else if (i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            Err("--json needs a path. {}", usage).print();
+            return 1;
+        }
+    }
+
+    for (const std::string_view name: selected) {
+        if (std::ranges::find(suites, name, [](const auto &suite) { return suite.first; }) != suites.end()) continue;
+
+        std::string names;
+        for (const auto &suite: suites) names += std::format(" {}", suite.first);
+        Err("Unknown suite {}, the suites are{}. {}", name, names, usage).print();
+        return 1;
+    }
+
+    bench::Reporter reporter;
+    for (const auto &[name, run]: suites) {
+        if (!selected.empty() && std::ranges::find(selected, name) == selected.end()) continue;
+        run(reporter);
+    }
+
+    if (!json_path.empty()) {
+        if (Err err = reporter.write_json(json_path)) {
+            err.print();
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,32 @@
+#include <bench.h>
+#include <scenes.h>
+#include <cpu/raymarcher.h>
+
+namespace bench {
+    void ray_packets(Reporter &reporter) {
+        constexpr uint32_t width = 640;
+        constexpr uint32_t height = 360;
+
+        cpu::ThreadPool pool;
+        const cpu::Raymarcher single(pool, cpu::Raymarcher::Traversal::SingleRay);
+        const cpu::Raymarcher packets(pool, cpu::Raymarcher::Traversal::Packets);
+
+        for (const auto &[name, scene]: standard_scenes()) {
+            Image single_image(width, height), packet_image(width, height);
+
+            const double single_ns = time_ns([&] { single.render(scene, single_image); },
+                                             std::chrono::milliseconds(1000));
+            const double packet_ns = time_ns([&] { packets.render(scene, packet_image); },
+                                             std::chrono::milliseconds(1000));
+
+            reporter.add("packets", name, "single_ray", single_ns / 1e6, "ms");
+            reporter.add("packets", name, "packets", packet_ns / 1e6, "ms");
+            reporter.add("packets", name, "speedup", single_ns / packet_ns, "x");
+
+            // Both traversals stop within eps of the surface, so the images should agree closely
+            if (const auto diff = diff_images(single_image, packet_image, 4.0f / 255.0f)) {
+                reporter.add("packets", name, "mismatched", diff->mismatched_fraction() * 100.0, "%");
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#include <bench.h>
+#include <scenes.h>
+#include <cpu/raymarcher.h>
+
+#include <array>
+#include <format>
+
+namespace bench {
+    void relaxed_marching(Reporter &reporter) {
+        constexpr uint32_t width = 320;
+        constexpr uint32_t height = 180;
+        constexpr std::array relaxations = {1.2f, 1.5f, 1.8f};
+
+        cpu::ThreadPool pool;
+        const cpu::Raymarcher raymarcher(pool, cpu::Raymarcher::Traversal::SingleRay);
+
+        for (auto &[name, scene]: standard_scenes()) {
+            Image plain_image(width, height), relaxed_image(width, height);
+
+            scene.relaxation = 1.0f;
+            const double plain_ns = time_ns([&] { raymarcher.render(scene, plain_image); },
+                                            std::chrono::milliseconds(1000));
+            const double plain_steps = static_cast<double>(raymarcher.num_steps());
+
+            reporter.add("relaxed", name, "plain_render", plain_ns / 1e6, "ms");
+            reporter.add("relaxed", name, "plain_steps", plain_steps / (width * height), "steps/px");
+
+            for (const float relaxation: relaxations) {
+                scene.relaxation = relaxation;
+                const double relaxed_ns = time_ns([&] { raymarcher.render(scene, relaxed_image); },
+                                                  std::chrono::milliseconds(1000));
+                const double relaxed_steps = static_cast<double>(raymarcher.num_steps());
+
+                const std::string variant = std::format("relax_{:.1f}", relaxation);
+                reporter.add("relaxed", name, variant + "_render", relaxed_ns / 1e6, "ms");
+                reporter.add("relaxed", name, variant + "_steps", relaxed_steps / (width * height), "steps/px");
+                reporter.add("relaxed", name, variant + "_saved", (1.0 - relaxed_steps / plain_steps) * 100.0, "%");
+
+                // Refined hits land on the surface like plain ones, only silhouettes should differ
+                if (const auto diff = diff_images(plain_image, relaxed_image, 4.0f / 255.0f)) {
+                    reporter.add("relaxed", name, variant + "_mismatched", diff->mismatched_fraction() * 100.0, "%");
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include <scenes.h>
+#include <utils/buf.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <format>
+
+namespace bench {
+    namespace {
+        Object make_object(const std::string &name, const ObjectType type, const glm::vec3 &pos,
+                           const glm::vec3 &scale, const glm::vec3 &color, const LinkType link = LinkType::Default) {
+            Object object(name, type, pos, scale, color);
+            object.link_type = link;
+            return object;
+        }
+
+        Object ground() {
+            return make_object("Ground", ObjectType::GridPlane, {0, -2, 0}, {2, 1, 2}, {1, 1, 1});
+        }
+
+        Scene sphere_field() {
+            Scene scene;
+            scene.root.children.push_back(ground());
+
+            for (int x = 0; x < 8; ++x) {
+                for (int z = 0; z < 8; ++z) {
+                    scene.root.children.push_back(
+                            make_object(std::format("Sphere {} {}", x, z), ObjectType::Sphere,
+                                        {8.0f + x * 3.0f, -0.5f, -10.5f + z * 3.0f}, {1, 1, 1},
+                                        {0.2f + x * 0.1f, 0.5f, 0.9f - z * 0.1f}));
+                }
+            }
+
+            scene.camera.pos = {0, 3, 0};
+            scene.camera.set_rotation(0, -12);
+            return scene;
+        }
+
+        Scene csg_groups() {
+            Scene scene;
+            scene.root.children.push_back(ground());
+
+            for (int i = 0; i < 6; ++i) {
+                const glm::vec3 pos(10.0f + (i % 3) * 6.0f, 0.5f, -4.0f + (i / 3) * 8.0f);
+
+                Object group = make_object(std::format("Group {}", i), ObjectType::Box, pos, {1.5f, 1.5f, 1.5f},
+                                           {0.9f, 0.4f, 0.3f});
+                group.children.push_back(make_object("Hole", ObjectType::Sphere, pos, {1.9f, 1, 1}, {1, 1, 1},
+                                                     LinkType::Subtraction));
+                group.children.push_back(make_object("Ring", ObjectType::Torus, pos + glm::vec3(0, 1.5f, 0),
+                                                     {2.0f, 0.4f, 1}, {0.3f, 0.8f, 0.4f}, LinkType::SoftUnion));
+                group.children.push_back(make_object("Clip", ObjectType::Octohedron, pos, {3.5f, 1, 1},
+                                                     {1, 1, 1}, LinkType::Intersection));
+                scene.root.children.push_back(std::move(group));
+            }
+
+            scene.camera.pos = {0, 4, 0};
+            scene.camera.set_rotation(0, -15);
+            return scene;
+        }
+
+        Scene all_primitives() {
+            Scene scene;
+            scene.root.children.push_back(ground());
+
+            const std::vector<std::pair<ObjectType, glm::vec3>> primitives = {
+                    {ObjectType::Sphere,     {1.0f, 1, 1}},
+                    {ObjectType::Box,        {1.0f, 1.0f, 1.0f}},
+                    {ObjectType::Torus,      {1.2f, 0.4f, 1}},
+                    {ObjectType::RoundBox,   {1.0f, 0.8f, 1.0f}},
+                    {ObjectType::Octohedron, {1.5f, 1, 1}},
+                    {ObjectType::HexPrism,   {1.0f, 1.0f, 1}},
+            };
+
+            for (size_t i = 0; i < primitives.size(); ++i) {
+                const auto &[type, scale] = primitives[i];
+                scene.root.children.push_back(
+                        make_object(std::format("Primitive {}", i), type, {12.0f, 0, -7.5f + i * 3.0f}, scale,
+                                    {0.8f, 0.8f - i * 0.1f, 0.3f + i * 0.1f}));
+            }
+
+            scene.camera.pos = {0, 2, 0};
+            scene.camera.set_rotation(0, -8);
+            return scene;
+        }
+
+        Scene repetition() {
+            Scene scene;
+            scene.root.children.push_back(
+                    make_object("Lattice", ObjectType::InfiniteSpheres, {0, 0, 0}, {6, 6, 6}, {0.6f, 0.7f, 0.9f}));
+
+            scene.camera.pos = {3, 3, 3};
+            scene.camera.set_rotation(20, 10);
+            return scene;
+        }
+    }
+
+    Scene object_grid(const size_t count) {
+        Scene scene;
+        scene.root.children.push_back(ground());
+
+        constexpr std::array<ObjectType, 4> types = {
+                ObjectType::Sphere, ObjectType::Box, ObjectType::Octohedron, ObjectType::Torus
+        };
+
+        const auto side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        for (size_t i = 0; i < count; ++i) {
+            const float x = static_cast<float>(i % side);
+            const float z = static_cast<float>(i / side);
+            scene.root.children.push_back(
+                    make_object(std::format("Object {}", i), types[i % types.size()],
+                                {6.0f + x * 1.5f, -1.4f, z * 1.5f - static_cast<float>(side) * 0.75f},
+                                {0.5f, 0.3f, 0.5f}, {0.3f + 0.7f * x / side, 0.5f, 0.9f - 0.7f * z / side}));
+        }
+
+        scene.camera.pos = {0, 6, 0};
+        scene.camera.set_rotation(0, -25);
+        return scene;
+    }
+
+    Scene folder_grid(const size_t count) {
+        Scene grid = object_grid(count);
+        std::vector<Object> &objects = grid.root.children;
+
+        Scene scene;
+        scene.camera = grid.camera;
+        for (size_t first = 0; first < objects.size(); first += FOLDER_SIZE) {
+            Object folder = make_object(std::format("Folder {}", first / FOLDER_SIZE), ObjectType::Empty, {0, 0, 0},
+                                        {1, 1, 1}, {1, 1, 1});
+
+            const size_t last = std::min(first + FOLDER_SIZE, objects.size());
+            folder.children.assign(std::make_move_iterator(objects.begin() + first),
+                                   std::make_move_iterator(objects.begin() + last));
+            scene.root.children.push_back(std::move(folder));
+        }
+        return scene;
+    }
+
+    std::vector<NamedScene> standard_scenes() {
+        std::vector<NamedScene> scenes;
+        scenes.push_back({"sphere_field", sphere_field()});
+        scenes.push_back({"csg_groups", csg_groups()});
+        scenes.push_back({"all_primitives", all_primitives()});
+        scenes.push_back({"repetition", repetition()});
+
+        if (std::filesystem::exists("test.scene")) {
+            Buffer buffer;
+            Scene scene;
+            if (!buffer.read_from_file("test.scene") && !scene.read_from_buffer(buffer)) {
+                scenes.push_back({"test.scene", std::move(scene)});
+            }
+        }
+
+        return scenes;
+    }
+}
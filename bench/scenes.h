@@ -0,0 +1,29 @@
+#ifndef RAYMARCHER_BENCH_SCENES_H
+#define RAYMARCHER_BENCH_SCENES_H
+
+#include <engine/scene.h>
+
+#include <string>
+#include <vector>
+
+namespace bench {
+    struct NamedScene {
+        std::string name;
+        Scene scene;
+    };
+
+    // Fixed scenes covering open space, CSG groups, every primitive and domain repetition.
+    // test.scene is appended when it exists in the working directory.
+    std::vector<NamedScene> standard_scenes();
+
+    // count small objects of mixed types laid out in a square grid on the ground, for scaling tests
+    Scene object_grid(size_t count);
+
+    // object_grid split into Empty folders of at most FOLDER_SIZE objects. Scene files store child counts in 16 bits,
+    // so this is the layout large grids can be saved in.
+    constexpr size_t FOLDER_SIZE = 1000;
+
+    Scene folder_grid(size_t count);
+}
+
+#endif //RAYMARCHER_BENCH_SCENES_H
@@ -0,0 +1,47 @@
+#include <bench.h>
+#include <cpu/sdf_simd.h>
+
+#include <random>
+
+namespace bench {
+    void sdf_primitives(Reporter &reporter) {
+        constexpr size_t num_points = 4096;
+
+        // Points spread around the object so every branch of the distance functions is taken
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> dist(-8.0f, 8.0f);
+        std::vector<float> x(num_points), y(num_points), z(num_points), out(num_points);
+        for (size_t i = 0; i < num_points; ++i) {
+            x[i] = dist(rng);
+            y[i] = dist(rng);
+            z[i] = dist(rng);
+        }
+
+        const std::vector<std::pair<ObjectType, std::string>> primitives = {
+                {ObjectType::Sphere,          "sphere"},
+                {ObjectType::Box,             "box"},
+                {ObjectType::Torus,           "torus"},
+                {ObjectType::InfiniteSpheres, "infinite_spheres"},
+                {ObjectType::RoundBox,        "round_box"},
+                {ObjectType::Octohedron,      "octahedron"},
+                {ObjectType::HexPrism,        "hex_prism"},
+                {ObjectType::GridPlane,       "plane"},
+        };
+
+        for (const auto &[type, name]: primitives) {
+            const ObjectRecord obj{type, {0.5f, -1.0f, 2.0f}, {2.0f, 1.0f, 1.5f}, {1, 1, 1}, 1, 48,
+                                   LinkType::Default, 0};
+
+            for (const cpu::Isa isa: {cpu::Isa::Scalar, cpu::Isa::AVX2, cpu::Isa::AVX512}) {
+                if (!cpu::isa_supported(isa)) continue;
+
+                const double ns = time_ns([&] {
+                    cpu::evaluate_batch(isa, obj, x.data(), y.data(), z.data(), out.data(), num_points);
+                    keep(out[num_points - 1]);
+                });
+
+                reporter.add("sdf", name, std::string(cpu::isa_name(isa)), ns / num_points, "ns/eval");
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <bench.h>
+#include <scenes.h>
+#include <compute/buffer.h>
+#include <utils/buf.h>
+
+#include <format>
+#include <iostream>
+
+namespace bench {
+    namespace {
+        size_t count_objects(const Object &object) {
+            size_t count = 1;
+            for (const Object &child: object.children) count += count_objects(child);
+            return count;
+        }
+    }
+
+    void serialization(Reporter &reporter) {
+        for (const size_t count: {10, 1000, 100000}) {
+            const Scene scene = folder_grid(count);
+            const size_t num_objects = count_objects(scene.root);
+            const std::string name = std::format("{}_objects", count);
+
+            // Whole scene files, as written at shutdown and read at startup
+            Buffer buffer;
+            const double write_ns = time_ns([&] {
+                buffer.reset();
+                scene.write_to_buffer(buffer);
+                keep(static_cast<float>(buffer.size()));
+            });
+
+            Scene read_scene;
+            buffer.rewind();
+            if (Err err = read_scene.read_from_buffer(buffer)) {
+                err.print();
+                std::cout << std::format("serialize: {} did not round trip, skipped.", name) << std::endl;
+                continue;
+            }
+            if (const size_t num_read = count_objects(read_scene.root); num_read != num_objects) {
+                std::cout << std::format("serialize: {} read back {} of {} objects, skipped.", name, num_read,
+                                         num_objects) << std::endl;
+                continue;
+            }
+
+            const double read_ns = time_ns([&] {
+                Scene loaded;
+                buffer.rewind();
+                loaded.read_from_buffer(buffer);
+                keep(static_cast<float>(loaded.root.children.size()));
+            });
+
+            // The object tree packed into GPU records
+            compute::ComputeBuffer compute_buffer(1024);
+            const double pack_ns = time_ns([&] {
+                compute_buffer.reset();
+                keep(static_cast<float>(scene.root.write_to_compute_buffer(compute_buffer).value_or(0)));
+            });
+
+            std::vector<ObjectRecord> records;
+            const double records_ns = time_ns([&] {
+                records.clear();
+                keep(static_cast<float>(scene.root.write_to_records(records)));
+            });
+
+            const double size_mb = static_cast<double>(buffer.size()) / (1024.0 * 1024.0);
+            reporter.add("serialize", name, "file_size", static_cast<double>(buffer.size()) / 1024.0, "KB");
+            reporter.add("serialize", name, "write", write_ns / 1e3, "us");
+            reporter.add("serialize", name, "write_rate", size_mb / (write_ns / 1e9), "MB/s");
+            reporter.add("serialize", name, "read", read_ns / 1e3, "us");
+            reporter.add("serialize", name, "read_rate", size_mb / (read_ns / 1e9), "MB/s");
+            reporter.add("serialize", name, "pack_compute", pack_ns / num_objects, "ns/object");
+            reporter.add("serialize", name, "pack_records", records_ns / num_objects, "ns/object");
+        }
+    }
+}
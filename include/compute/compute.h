@@ -3,29 +3,70 @@
 
 #include <utils/err.h>
 #include <compute/buffer.h>
+#include <compute/mapped_buffer.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <expected>
+#include <functional>
 #include <string>
 #include <filesystem>
+#include <unordered_map>
 
 namespace compute {
+    std::expected<std::string, Err> read_shader_source(const std::filesystem::path &shader_path);
+
+    // Lets maps keyed by std::string be searched with string_views
+    struct StringHash {
+        using is_transparent = void;
+
+        size_t operator()(const std::string_view str) const { return std::hash<std::string_view>{}(str); }
+    };
+
     class ComputeShader {
-        GLuint shader_id;
-        GLuint program_id;
+        GLuint shader_id = 0;
+        GLuint program_id = 0;
+
+        // Source of a compile that still has to be written to the program cache
+        std::string uncached_source;
+
+        // Locations of the loose uniforms, read once the program is linked. Members of uniform blocks have none.
+        std::unordered_map<std::string, GLint, StringHash, std::equal_to<>> uniform_locations;
+
+        [[nodiscard]] Err check_status() const;
+
+        // Waits for the compile to finish and caches the program binary
+        Err finish();
+
+        void cache_uniform_locations();
+
+        [[nodiscard]] GLint uniform_location(std::string_view id) const;
 
     public:
         Err init(const std::filesystem::path &shader_path);
 
         Err init(const std::string &code);
 
+        // Queues compilation and returns straight away, unless the program cache has a binary for code. With
+        // GL_KHR_parallel_shader_compile the driver compiles in the background, otherwise the work happens on the
+        // first call to poll().
+        Err init_async(const std::string &code);
+
+        // Whether an init_async compile has finished, or why it failed
+        [[nodiscard]] std::expected<bool, Err> poll();
+
+        void destroy();
+
         void activate() const;
 
+        // Queries the GL state, bind_buffer() and execute() only check it in debug builds
         [[nodiscard]] bool is_active() const;
 
         Err bind_buffer(const ComputeBuffer &buf, GLuint index) const;
 
+        Err bind_buffer(const MappedBuffer &buf, GLuint index) const;
+
         Err execute(GLuint nx, GLuint ny, GLuint nz) const;
 
         Err bind(const std::string_view &id, const GLint value) const;
@@ -38,6 +79,8 @@ namespace compute {
 
         Err bind(const std::string_view &id, const glm::vec3 &value) const;
 
+        Err bind(const std::string_view &id, const glm::uvec3 &value) const;
+
         Err bind(const std::string_view &id, const glm::mat4x4 &value) const;
 
     };
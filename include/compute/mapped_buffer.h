@@ -0,0 +1,65 @@
+#ifndef RAYMARCHER_MAPPED_BUFFER_H
+#define RAYMARCHER_MAPPED_BUFFER_H
+
+#include <utils/algo.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace compute {
+    // Shader storage or uniform buffer that stays mapped for its whole life, holding NUM_REGIONS copies of its
+    // contents. New contents go to the region after the bound one, which the GPU is done reading by then, so updates
+    // neither stall nor reallocate. Only the records that differ from what that region held are copied into it, and
+    // contents equal to the bound region's upload nothing.
+    class MappedBuffer {
+    public:
+        static constexpr size_t NUM_REGIONS = 3;
+
+        // Updates compare and copy whole records of record_size bytes
+        explicit MappedBuffer(size_t record_size, GLenum target = GL_SHADER_STORAGE_BUFFER);
+
+        Err init();
+
+        Err update(const void *data, size_t size);
+
+        template<trivial_type T>
+        Err update(const std::vector<T> &records) {
+            return update(records.data(), records.size() * sizeof(T));
+        }
+
+        // Fences the bound region behind the frame's commands, it is not written again before they finished
+        void end_frame();
+
+        void bind(GLuint index) const;
+
+        // Size of the contents, and bytes the last update copied to the GPU
+        [[nodiscard]] size_t size() const { return contents[region].size(); }
+
+        [[nodiscard]] size_t bytes_uploaded() const { return last_upload; }
+
+    private:
+        size_t record_size;
+        GLenum target;
+
+        GLuint buffer_id = 0;
+        uint8_t *mapped = nullptr;
+        size_t region_capacity = 0;
+        size_t offset_alignment = 1;
+
+        // What every region holds, and the bound one
+        std::array<std::vector<uint8_t>, NUM_REGIONS> contents;
+        std::array<GLsync, NUM_REGIONS> fences{};
+        size_t region = 0;
+
+        size_t last_upload = 0;
+
+        // Replaces the storage with one whose regions fit size bytes, every region starts out empty
+        Err allocate(size_t size);
+    };
+}
+
+#endif //RAYMARCHER_MAPPED_BUFFER_H
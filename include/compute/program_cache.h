@@ -0,0 +1,48 @@
+#ifndef RAYMARCHER_PROGRAM_CACHE_H
+#define RAYMARCHER_PROGRAM_CACHE_H
+
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// On-disk cache of linked program binaries (glGetProgramBinary), so startup skips compiling shaders from source.
+// Entries are keyed by a hash of the program's sources together with the GL vendor, renderer and version, so a
+// driver update or an edited shader simply misses. Binaries the driver refuses anyway are deleted.
+//
+// Every structural scene edit compiles a specialized variant with its own source, so the cache keeps at most
+// MAX_PROGRAM_CACHE_ENTRIES binaries. Loading an entry marks it as used, and storing one deletes the least recently
+// used entries over the limit.
+namespace compute {
+    constexpr size_t MAX_PROGRAM_CACHE_ENTRIES = 64;
+
+    struct ProgramCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+
+        // Cached binaries the driver refused to load, counted as misses as well
+        size_t rejected = 0;
+
+        double load_ms = 0;
+        double compile_ms = 0;
+    };
+
+    // An empty directory disables the cache
+    void set_program_cache_dir(const std::filesystem::path &dir);
+
+    // Links program from a cached binary of sources. Returns false on a miss, leaving program untouched.
+    bool load_program_binary(GLuint program, std::string_view sources);
+
+    // Program must be linked, and should have GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before linking
+    Err store_program_binary(GLuint program, std::string_view sources);
+
+    // Adds time spent building a program from source after a miss
+    void record_program_compile(double ms);
+
+    const ProgramCacheStats &program_cache_stats();
+}
+
+#endif //RAYMARCHER_PROGRAM_CACHE_H
@@ -0,0 +1,82 @@
+#ifndef RAYMARCHER_READBACK_H
+#define RAYMARCHER_READBACK_H
+
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <optional>
+
+// Results the GPU produces for a frame are read back once it finished the frame, polled without ever waiting for it.
+// The statistics built on them lag a frame or two behind the image.
+namespace compute {
+    // Fence behind the commands issued before signal()
+    class GpuFence {
+    public:
+        // Replaces an earlier fence that was not seen finished
+        void signal();
+
+        // Between signal() and the poll() that saw the commands finish
+        [[nodiscard]] bool pending() const { return sync != nullptr; }
+
+        // Whether the commands finished since signal(). True once per signal(), later calls return false.
+        bool poll();
+
+    private:
+        GLsync sync = nullptr;
+    };
+
+    // Frames cycle through N slots of results, each read back once its frame finished. A frame whose slot is still in
+    // flight is left out instead of waiting for it.
+    template<typename Slot, size_t N>
+    class ReadbackRing {
+    public:
+        std::array<Slot, N> slots{};
+
+        // Slot for the current frame's results, or nullptr while it is in flight. A returned slot has to be fenced
+        // with end_frame() after the commands that write it.
+        Slot *begin_frame() { return fences[next].pending() ? nullptr : &slots[next]; }
+
+        void end_frame() {
+            fences[next].signal();
+            next = (next + 1) % N;
+        }
+
+        // Calls read with every slot whose frame finished, oldest first, so the newest results are read last
+        template<typename F>
+        void read_finished(F &&read) {
+            for (size_t i = 0; i < N; i++) {
+                const size_t idx = (next + i) % N;
+                if (fences[idx].poll()) read(slots[idx]);
+            }
+        }
+
+    private:
+        std::array<GpuFence, N> fences;
+        size_t next = 0;
+    };
+
+    // GPU time between begin() and end(), from a pair of timestamp queries. Only one measurement is in flight.
+    class GpuTimer {
+    public:
+        Err init();
+
+        // Whether begin() may start a measurement, the last one was read back
+        [[nodiscard]] bool ready() const { return !pending; }
+
+        void begin();
+
+        void end();
+
+        // Milliseconds of the measurement once the GPU finished it, nothing before and after
+        std::optional<float> poll_ms();
+
+    private:
+        std::array<GLuint, 2> query_ids{};
+        bool pending = false;
+    };
+}
+
+#endif //RAYMARCHER_READBACK_H
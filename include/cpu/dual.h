@@ -0,0 +1,92 @@
+#ifndef RAYMARCHER_DUAL_H
+#define RAYMARCHER_DUAL_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Forward mode dual numbers carrying a value's gradient with respect to the sample position. The distance functions
+// in sdf.h and the combine ops in program_eval.h are templated over float and Dual, running them on Duals gives
+// the analytic gradients the shader's sdg* functions compute by hand.
+namespace cpu {
+    struct Dual {
+        float v = 0;
+        glm::vec3 d{0};
+
+        Dual() = default;
+
+        // Constants have no gradient
+        Dual(const float v) : v(v) {}
+
+        Dual(const float v, const glm::vec3 &d) : v(v), d(d) {}
+    };
+
+    struct DualVec3 {
+        Dual x, y, z;
+    };
+
+    // A position whose components are the variables the gradient is taken over
+    inline DualVec3 dual_position(const glm::vec3 &p) {
+        return {{p.x, {1, 0, 0}}, {p.y, {0, 1, 0}}, {p.z, {0, 0, 1}}};
+    }
+
+    inline Dual operator-(const Dual &a) { return {-a.v, -a.d}; }
+    inline Dual operator+(const Dual &a, const Dual &b) { return {a.v + b.v, a.d + b.d}; }
+    inline Dual operator-(const Dual &a, const Dual &b) { return {a.v - b.v, a.d - b.d}; }
+    inline Dual operator*(const Dual &a, const Dual &b) { return {a.v * b.v, a.d * b.v + b.d * a.v}; }
+    inline Dual operator/(const Dual &a, const Dual &b) { return {a.v / b.v, (a.d * b.v - b.d * a.v) / (b.v * b.v)}; }
+
+    // Compare values, like the branches of the functions they stand in for
+    inline bool operator<(const Dual &a, const Dual &b) { return a.v < b.v; }
+    inline bool operator>(const Dual &a, const Dual &b) { return a.v > b.v; }
+
+    inline DualVec3 operator-(const DualVec3 &a, const DualVec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    inline DualVec3 operator-(const glm::vec3 &a, const DualVec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    inline DualVec3 operator-(const DualVec3 &a, const glm::vec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    inline DualVec3 operator+(const DualVec3 &a, const float b) { return {a.x + b, a.y + b, a.z + b}; }
+    inline DualVec3 operator*(const glm::vec3 &a, const DualVec3 &b) { return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+    inline DualVec3 operator/(const DualVec3 &a, const glm::vec3 &b) { return {a.x / b.x, a.y / b.y, a.z / b.z}; }
+
+    // The math the distance functions use, overloaded for both floats and Duals so the templates read the same
+    namespace ad {
+        inline float value(const float a) { return a; }
+        inline float value(const Dual &a) { return a.v; }
+
+        inline float abs(const float a) { return std::abs(a); }
+        inline float max(const float a, const float b) { return glm::max(a, b); }
+        inline float min(const float a, const float b) { return glm::min(a, b); }
+        inline float sqrt(const float a) { return std::sqrt(a); }
+        inline float length(const float x, const float y) { return glm::length(glm::vec2(x, y)); }
+
+        inline glm::vec3 abs(const glm::vec3 &a) { return glm::abs(a); }
+        inline glm::vec3 max(const glm::vec3 &a, const float b) { return glm::max(a, b); }
+        inline glm::vec3 round(const glm::vec3 &a) { return glm::round(a); }
+        inline float length(const glm::vec3 &a) { return glm::length(a); }
+        inline float dot(const glm::vec3 &a, const glm::vec3 &b) { return glm::dot(a, b); }
+
+        inline Dual abs(const Dual &a) { return a.v < 0 ? -a : a; }
+        inline Dual max(const Dual &a, const Dual &b) { return a.v < b.v ? b : a; }
+        inline Dual min(const Dual &a, const Dual &b) { return b.v < a.v ? b : a; }
+
+        // Zero gradient where the derivative blows up, which only happens exactly on a distance function's center
+        inline Dual sqrt(const Dual &a) {
+            const float s = std::sqrt(a.v);
+            return {s, s > 0 ? a.d / (2.0f * s) : glm::vec3(0)};
+        }
+
+        inline Dual length(const Dual &x, const Dual &y) { return ad::sqrt(x * x + y * y); }
+
+        inline DualVec3 abs(const DualVec3 &a) { return {abs(a.x), abs(a.y), abs(a.z)}; }
+        inline DualVec3 max(const DualVec3 &a, const float b) { return {max(a.x, b), max(a.y, b), max(a.z, b)}; }
+
+        // Piecewise constant
+        inline DualVec3 round(const DualVec3 &a) {
+            return {std::round(a.x.v), std::round(a.y.v), std::round(a.z.v)};
+        }
+
+        inline Dual length(const DualVec3 &a) { return ad::sqrt(a.x * a.x + a.y * a.y + a.z * a.z); }
+        inline Dual dot(const DualVec3 &a, const glm::vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    }
+}
+
+#endif //RAYMARCHER_DUAL_H
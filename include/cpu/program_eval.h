@@ -0,0 +1,56 @@
+#ifndef RAYMARCHER_PROGRAM_EVAL_H
+#define RAYMARCHER_PROGRAM_EVAL_H
+
+#include <cpu/dual.h>
+#include <engine/sdf_program.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Distance-only interpreters for compiled scene programs, shared by the packet marcher and the field baker.
+// Colors are left out, callers that shade go through the full interpreter in raymarcher.cpp.
+namespace cpu {
+    // Points evaluate_group handles per pass, larger batches are split
+    constexpr size_t MAX_GROUP_BATCH = 512;
+
+    // Distance part of the shader's combine. On Duals it carries the gradient through the op like
+    // combine_gradient in the shader.
+    template<typename S>
+    S combine_distance(const SdfOp op, const S &a, const S &b) {
+        switch (op) {
+            case SdfOp::Union:
+                return a < b ? a : b;
+            case SdfOp::SmoothUnion: {
+                // smooth_min blends whole vec4s, the distance included
+                constexpr float k = 10;
+                const S h = ad::max(k - ad::abs(a - b), 0.0f) / k;
+                const S m = h * h * 0.5f;
+                const S blend = a < b ? m : 1.0f - m;
+                return (1.0f - blend) * a + blend * b;
+            }
+            case SdfOp::Subtract:
+                return ad::max(-b, a);
+            case SdfOp::Intersect:
+                return ad::max(a, b);
+            default:
+                return a;
+        }
+    }
+
+    // combine_distance for count values at once
+    void combine_distances(SdfOp op, float *curr, const float *other, size_t count);
+
+    // Distance of a group at a single point
+    [[nodiscard]] float evaluate_group(const SdfProgram &program, const SdfGroup &group, const glm::vec3 &pos);
+
+    // Distance of a group at a single point with its gradient, for surface normals
+    [[nodiscard]] Dual evaluate_group_gradient(const SdfProgram &program, const SdfGroup &group, const glm::vec3 &pos);
+
+    // Distance of a group at count points in structure-of-arrays layout. The group's program runs once per batch
+    // with every register holding a distance per point, and every Eval goes through the SIMD kernels.
+    void evaluate_group(const SdfProgram &program, const SdfGroup &group, const float *x, const float *y,
+                        const float *z, float *out, size_t count);
+}
+
+#endif //RAYMARCHER_PROGRAM_EVAL_H
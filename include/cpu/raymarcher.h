@@ -0,0 +1,46 @@
+#ifndef RAYMARCHER_CPU_RAYMARCHER_H
+#define RAYMARCHER_CPU_RAYMARCHER_H
+
+#include <cpu/thread_pool.h>
+#include <engine/baked_field.h>
+#include <engine/scene.h>
+#include <utils/image.h>
+#include <utils/err.h>
+
+namespace cpu {
+    // Reference implementation of raymarching_shader.glsl. Renders a Scene without a GPU by splitting
+    // the image into tiles and marching them on a thread pool.
+    class Raymarcher {
+    public:
+        enum class Traversal {
+            // Every pixel marches on its own, exactly like the shader
+            SingleRay,
+            // Square pixel packets march together with the smallest safe step of their rays, and split into
+            // smaller packets and finally single rays once the rays diverge
+            Packets
+        };
+
+        // Same footprint as the compute shader's workgroups
+        static constexpr uint32_t TILE_SIZE = 32;
+
+        static constexpr uint32_t PACKET_SIZE = 8;
+        static constexpr uint32_t MIN_PACKET_SIZE = 4;
+
+        explicit Raymarcher(ThreadPool &pool, Traversal traversal = Traversal::Packets);
+
+        // Renders at the image's current resolution. With a baked_field, the scene's static groups are baked into it
+        // first and marched through it like the shader does, see baked_field.h.
+        Err render(const Scene &scene, Image &image, BakedField *baked_field = nullptr) const;
+
+        // Marching steps taken by the last render, shadow rays included. Packet steps count once per ray.
+        [[nodiscard]] uint64_t num_steps() const { return last_num_steps; }
+
+    private:
+        ThreadPool &pool;
+        Traversal traversal;
+
+        mutable uint64_t last_num_steps = 0;
+    };
+}
+
+#endif //RAYMARCHER_CPU_RAYMARCHER_H
@@ -0,0 +1,152 @@
+#ifndef RAYMARCHER_SDF_H
+#define RAYMARCHER_SDF_H
+
+#include <cpu/dual.h>
+#include <engine/object.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Scalar ports of the distance functions in raymarching_shader.glsl. Keep the two in sync.
+//
+// The ones with a closed form gradient are templated over the position type, p is either a glm::vec3 or a
+// DualVec3. Their Dual versions mirror the shader's sdg* functions.
+namespace cpu {
+    constexpr float MAX_DIST = 1234567890123456789024.0f;
+
+    // Spacing of the four samples estimating the gradient of the other distance functions, must match
+    // gradient_eps in the shader
+    constexpr float GRADIENT_EPS = 0.001f;
+
+    template<typename V>
+    auto sd_sphere(const V &p, const float s) {
+        return ad::length(p) - s;
+    }
+
+    template<typename V>
+    auto sd_box(const V &p, const glm::vec3 &b) {
+        const V q = ad::abs(p) - b;
+        return ad::length(ad::max(q, 0.0f)) + ad::min(ad::max(q.x, ad::max(q.y, q.z)), 0.0f);
+    }
+
+    template<typename V>
+    auto sd_torus(const V &p, const glm::vec2 &t) {
+        return ad::length(ad::length(p.x, p.z) - t.x, p.y) - t.y;
+    }
+
+    template<typename V>
+    auto sd_infinite_spheres(const V &p, const glm::vec3 &s) {
+        const V q = p - s * ad::round(p / s);
+        return sd_sphere(q, 1);
+    }
+
+    template<typename V>
+    auto sd_round_box(const V &p, const glm::vec3 &b, const float r) {
+        const V q = ad::abs(p) - b + r;
+        return ad::length(ad::max(q, 0.0f)) + ad::min(ad::max(q.x, ad::max(q.y, q.z)), 0.0f) - r;
+    }
+
+    inline float sd_octahedron(glm::vec3 p, const float s) {
+        p = glm::abs(p);
+        const float m = p.x + p.y + p.z - s;
+
+        glm::vec3 q;
+        if (3.0f * p.x < m) q = p;
+        else if (3.0f * p.y < m) q = glm::vec3(p.y, p.z, p.x);
+        else if (3.0f * p.z < m) q = glm::vec3(p.z, p.x, p.y);
+        else return m * 0.57735027f;
+
+        const float k = glm::clamp(0.5f * (q.z - q.y + s), 0.0f, s);
+        return glm::length(glm::vec3(q.x, q.y - s + k, q.z - k));
+    }
+
+    inline float sd_hex_prism(glm::vec3 p, const glm::vec2 &h) {
+        const glm::vec3 k(-0.8660254f, 0.5f, 0.57735f);
+        p = glm::abs(p);
+
+        const float fold = 2.0f * glm::min(k.x * p.x + k.y * p.y, 0.0f);
+        p.x -= fold * k.x;
+        p.y -= fold * k.y;
+
+        const glm::vec2 d(
+                glm::length(glm::vec2(p.x - glm::clamp(p.x, -k.z * h.x, k.z * h.x), p.y - h.x)) *
+                glm::sign(p.y - h.x),
+                p.z - h.y);
+        return glm::min(glm::max(d.x, d.y), 0.0f) + glm::length(glm::max(d, 0.0f));
+    }
+
+    template<typename V>
+    auto sd_plane(const V &p, const glm::vec3 &n, const float h) {
+        // n must be normalized
+        return ad::dot(p, n) + h;
+    }
+
+    // Select distance function based on object type
+    inline float find_distance_to_object(const ObjectRecord &curr, const glm::vec3 &pos) {
+        const glm::vec3 p = curr.pos - pos;
+
+        switch (curr.type) {
+            case ObjectType::Sphere:
+                return sd_sphere(p, curr.scale.x);
+            case ObjectType::Box:
+                return sd_box(p, curr.scale);
+            case ObjectType::Torus:
+                return sd_torus(p, glm::vec2(curr.scale.x, curr.scale.y));
+            case ObjectType::InfiniteSpheres:
+                return sd_infinite_spheres(p, curr.scale);
+            case ObjectType::RoundBox:
+                return sd_round_box(p, curr.scale, 0.1f);
+            case ObjectType::Octohedron:
+                return sd_octahedron(p, curr.scale.x);
+            case ObjectType::HexPrism:
+                return sd_hex_prism(p, glm::vec2(curr.scale.x, curr.scale.y));
+            case ObjectType::GridPlane:
+                return sd_plane(pos, glm::vec3(0, 1, 0), -curr.pos.y);
+            default:
+                return MAX_DIST;
+        }
+    }
+
+    // Gradient from four samples on a tetrahedron around pos, the distance is their mean
+    inline Dual estimate_object_gradient(const ObjectRecord &curr, const glm::vec3 &pos) {
+        constexpr glm::vec3 taps[4] = {{1, -1, -1}, {-1, -1, 1}, {-1, 1, -1}, {1, 1, 1}};
+
+        Dual result;
+        for (const glm::vec3 &tap: taps) {
+            const float dist = find_distance_to_object(curr, pos + tap * GRADIENT_EPS);
+            result.v += dist * 0.25f;
+            result.d += tap * dist;
+        }
+        result.d /= 4.0f * GRADIENT_EPS;
+        return result;
+    }
+
+    // find_distance_to_object with its gradient with respect to pos, mirrors find_gradient_to_object in the shader
+    inline Dual find_gradient_to_object(const ObjectRecord &curr, const glm::vec3 &pos) {
+        const DualVec3 dual_pos = dual_position(pos);
+        const DualVec3 p = curr.pos - dual_pos;
+
+        switch (curr.type) {
+            case ObjectType::Sphere:
+                return sd_sphere(p, curr.scale.x);
+            case ObjectType::Box:
+                return sd_box(p, curr.scale);
+            case ObjectType::Torus:
+                return sd_torus(p, glm::vec2(curr.scale.x, curr.scale.y));
+            case ObjectType::InfiniteSpheres:
+                return sd_infinite_spheres(p, curr.scale);
+            case ObjectType::RoundBox:
+                return sd_round_box(p, curr.scale, 0.1f);
+            case ObjectType::Octohedron:
+            case ObjectType::HexPrism:
+                return estimate_object_gradient(curr, pos);
+            case ObjectType::GridPlane:
+                return sd_plane(dual_pos, glm::vec3(0, 1, 0), -curr.pos.y);
+            default:
+                return MAX_DIST;
+        }
+    }
+}
+
+#endif //RAYMARCHER_SDF_H
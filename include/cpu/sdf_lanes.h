@@ -0,0 +1,207 @@
+#ifndef RAYMARCHER_SDF_LANES_H
+#define RAYMARCHER_SDF_LANES_H
+
+#include <cpu/sdf.h>
+#include <engine/object.h>
+
+#include <cstddef>
+
+// The distance functions of cpu/sdf.h written once against a SIMD lane type V. Only include this from a
+// translation unit compiled for the target instruction set, and keep V in an anonymous namespace there so
+// the instantiations never leak into code that runs on older CPUs.
+//
+// V provides: V(float), V::width, V::load, store, arithmetic operators including unary minus, < and >
+// returning V::Mask (with &, | and ~), and free functions min, max, abs, sqrt, round, select(mask, a, b).
+namespace cpu::lanes {
+    template<typename V>
+    inline V length(const V &x, const V &y) {
+        return sqrt(x * x + y * y);
+    }
+
+    template<typename V>
+    inline V length(const V &x, const V &y, const V &z) {
+        return sqrt(x * x + y * y + z * z);
+    }
+
+    template<typename V>
+    inline V clamp(const V &x, const V &lo, const V &hi) {
+        return min(max(x, lo), hi);
+    }
+
+    template<typename V>
+    inline V sign(const V &x) {
+        return select(x > V(0.0f), V(1.0f), select(x < V(0.0f), V(-1.0f), V(0.0f)));
+    }
+
+    template<typename V>
+    inline V sd_sphere(const V &px, const V &py, const V &pz, const V &s) {
+        return length(px, py, pz) - s;
+    }
+
+    template<typename V>
+    inline V sd_box(const V &px, const V &py, const V &pz, const V &bx, const V &by, const V &bz) {
+        const V qx = abs(px) - bx;
+        const V qy = abs(py) - by;
+        const V qz = abs(pz) - bz;
+        const V zero(0.0f);
+        return length(max(qx, zero), max(qy, zero), max(qz, zero)) + min(max(qx, max(qy, qz)), zero);
+    }
+
+    template<typename V>
+    inline V sd_torus(const V &px, const V &py, const V &pz, const V &tx, const V &ty) {
+        const V qx = length(px, pz) - tx;
+        return length(qx, py) - ty;
+    }
+
+    template<typename V>
+    inline V sd_infinite_spheres(const V &px, const V &py, const V &pz, const V &sx, const V &sy, const V &sz) {
+        const V qx = px - sx * round(px / sx);
+        const V qy = py - sy * round(py / sy);
+        const V qz = pz - sz * round(pz / sz);
+        return sd_sphere(qx, qy, qz, V(1.0f));
+    }
+
+    template<typename V>
+    inline V sd_round_box(const V &px, const V &py, const V &pz, const V &bx, const V &by, const V &bz,
+                          const V &r) {
+        const V qx = abs(px) - bx + r;
+        const V qy = abs(py) - by + r;
+        const V qz = abs(pz) - bz + r;
+        const V zero(0.0f);
+        return length(max(qx, zero), max(qy, zero), max(qz, zero)) + min(max(qx, max(qy, qz)), zero) - r;
+    }
+
+    // Branchless version of the three way swizzle in sdOctahedron
+    template<typename V>
+    inline V sd_octahedron(const V &px_in, const V &py_in, const V &pz_in, const V &s) {
+        const V px = abs(px_in);
+        const V py = abs(py_in);
+        const V pz = abs(pz_in);
+        const V m = px + py + pz - s;
+
+        const auto use_x = V(3.0f) * px < m;
+        const auto use_y = ~use_x & (V(3.0f) * py < m);
+        const auto use_z = ~use_x & ~use_y & (V(3.0f) * pz < m);
+
+        const V qx = select(use_x, px, select(use_y, py, pz));
+        const V qy = select(use_x, py, select(use_y, pz, px));
+        const V qz = select(use_x, pz, select(use_y, px, py));
+
+        const V k = clamp(V(0.5f) * (qz - qy + s), V(0.0f), s);
+        const V inside = length(qx, qy - s + k, qz - k);
+
+        return select(use_x | use_y | use_z, inside, m * V(0.57735027f));
+    }
+
+    template<typename V>
+    inline V sd_hex_prism(const V &px_in, const V &py_in, const V &pz_in, const V &hx, const V &hy) {
+        const V kx(-0.8660254f), ky(0.5f), kz(0.57735f);
+
+        V px = abs(px_in);
+        V py = abs(py_in);
+        const V pz = abs(pz_in);
+
+        const V fold = V(2.0f) * min(kx * px + ky * py, V(0.0f));
+        px = px - fold * kx;
+        py = py - fold * ky;
+
+        const V dx = length(px - clamp(px, -kz * hx, kz * hx), py - hx) * sign(py - hx);
+        const V dy = pz - hy;
+
+        const V zero(0.0f);
+        return min(max(dx, dy), zero) + length(max(dx, zero), max(dy, zero));
+    }
+
+    // Runs dist(px, py, pz, wx, wy, wz) over count points, where p is relative to the object and w is the
+    // world position. The tail is padded out to a full vector.
+    template<typename V, typename Fn>
+    inline void for_each_batch(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                               const size_t count, const Fn &dist) {
+        const V ox(obj.pos.x), oy(obj.pos.y), oz(obj.pos.z);
+
+        const auto eval = [&](const float *bx, const float *by, const float *bz, float *bout) {
+            const V wx = V::load(bx), wy = V::load(by), wz = V::load(bz);
+            dist(ox - wx, oy - wy, oz - wz, wx, wy, wz).store(bout);
+        };
+
+        size_t i = 0;
+        for (; i + V::width <= count; i += V::width) {
+            eval(x + i, y + i, z + i, out + i);
+        }
+
+        if (i < count) {
+            alignas(64) float tx[V::width] = {}, ty[V::width] = {}, tz[V::width] = {}, tout[V::width];
+            for (size_t j = i; j < count; ++j) {
+                tx[j - i] = x[j];
+                ty[j - i] = y[j];
+                tz[j - i] = z[j];
+            }
+
+            eval(tx, ty, tz, tout);
+
+            for (size_t j = i; j < count; ++j) {
+                out[j] = tout[j - i];
+            }
+        }
+    }
+
+    // Batched find_distance_to_object. The type switch is hoisted out of the loop.
+    template<typename V>
+    inline void evaluate(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                         const size_t count) {
+        const V sx(obj.scale.x), sy(obj.scale.y), sz(obj.scale.z);
+
+        switch (obj.type) {
+            case ObjectType::Sphere:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_sphere(px, py, pz, sx);
+                });
+                break;
+            case ObjectType::Box:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_box(px, py, pz, sx, sy, sz);
+                });
+                break;
+            case ObjectType::Torus:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_torus(px, py, pz, sx, sy);
+                });
+                break;
+            case ObjectType::InfiniteSpheres:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_infinite_spheres(px, py, pz, sx, sy, sz);
+                });
+                break;
+            case ObjectType::RoundBox:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_round_box(px, py, pz, sx, sy, sz, V(0.1f));
+                });
+                break;
+            case ObjectType::Octohedron:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_octahedron(px, py, pz, sx);
+                });
+                break;
+            case ObjectType::HexPrism:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V px, V py, V pz, V, V, V) {
+                    return sd_hex_prism(px, py, pz, sx, sy);
+                });
+                break;
+            case ObjectType::GridPlane: {
+                // sdPlane(pos, (0, 1, 0), -obj.y) works on the world position
+                const V height(obj.pos.y);
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V, V, V, V, V wy, V) {
+                    return wy - height;
+                });
+                break;
+            }
+            default:
+                for_each_batch<V>(obj, x, y, z, out, count, [&](V, V, V, V, V, V) {
+                    return V(MAX_DIST);
+                });
+                break;
+        }
+    }
+}
+
+#endif //RAYMARCHER_SDF_LANES_H
@@ -0,0 +1,54 @@
+#ifndef RAYMARCHER_SDF_SIMD_H
+#define RAYMARCHER_SDF_SIMD_H
+
+#include <engine/object.h>
+
+#include <cstddef>
+#include <string_view>
+
+// Batched distance functions. Points are passed in structure-of-arrays layout and evaluated 8 (AVX2) or
+// 16 (AVX-512) at a time. The instruction set is picked at runtime, with the scalar functions from cpu/sdf.h
+// as the fallback.
+namespace cpu {
+    enum class Isa : uint32_t {
+        Scalar, AVX2, AVX512
+    };
+
+    constexpr size_t MAX_SIMD_WIDTH = 16;
+
+    [[nodiscard]] std::string_view isa_name(Isa isa);
+
+    [[nodiscard]] constexpr size_t isa_width(const Isa isa) {
+        switch (isa) {
+            case Isa::AVX2:
+                return 8;
+            case Isa::AVX512:
+                return 16;
+            default:
+                return 1;
+        }
+    }
+
+    // Whether this build contains kernels for isa and the running CPU and OS support it
+    [[nodiscard]] bool isa_supported(Isa isa);
+
+    // Best supported instruction set. Detected once.
+    [[nodiscard]] Isa active_isa();
+
+    // out[i] = find_distance_to_object(obj, {x[i], y[i], z[i]}) using the active instruction set
+    void evaluate_batch(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                        size_t count);
+
+    // Same as above with an explicit instruction set. Returns false when isa is not supported.
+    bool evaluate_batch(Isa isa, const ObjectRecord &obj, const float *x, const float *y, const float *z,
+                        float *out, size_t count);
+
+    // Per instruction set entry points, only valid when isa_supported() holds
+    void evaluate_batch_avx2(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                             size_t count);
+
+    void evaluate_batch_avx512(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                               size_t count);
+}
+
+#endif //RAYMARCHER_SDF_SIMD_H
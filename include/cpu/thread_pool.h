@@ -0,0 +1,67 @@
+#ifndef RAYMARCHER_THREAD_POOL_H
+#define RAYMARCHER_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+    // Work-stealing pool. Every worker owns a deque; it pops work from the back of its own deque
+    // and steals from the front of the others once it runs dry.
+    class ThreadPool {
+        struct Job {
+            const std::function<void(size_t)> *fn;
+            std::atomic<size_t> remaining;
+        };
+
+        struct Task {
+            Job *job;
+            size_t index;
+        };
+
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex sleep_mutex;
+        std::condition_variable wake_cv;
+        std::condition_variable done_cv;
+        std::atomic<size_t> pending_tasks = 0;
+        bool stopping = false;
+
+        void worker_loop(size_t worker_idx);
+
+        bool try_pop(size_t queue_idx, Task &task);
+
+        bool try_steal(size_t thief_idx, Task &task);
+
+        void run(const Task &task);
+
+    public:
+        explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Runs fn(i) for every i in [0, count) and blocks until all calls have returned.
+        // The calling thread helps out while it waits.
+        void parallel_for(size_t count, const std::function<void(size_t)> &fn);
+
+        [[nodiscard]] size_t size() const { return workers.size(); }
+    };
+}
+
+#endif //RAYMARCHER_THREAD_POOL_H
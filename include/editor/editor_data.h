@@ -3,6 +3,10 @@
 
 #include <engine/scene.h>
 #include <engine/image_renderer.h>
+#include <engine/shader_variants.h>
+#include <engine/render_on_demand.h>
+#include <engine/resolution_governor.h>
+#include <engine/frame_profiler.h>
 
 namespace editor {
     struct InputState {
@@ -16,6 +20,11 @@ namespace editor {
         Scene &scene;
         InputState &inputs;
         ImageRenderer &renderer;
+        ShaderVariants &shaders;
+        SceneBuffers &scene_buffers;
+        RenderOnDemand &render_on_demand;
+        ResolutionGovernor &governor;
+        FrameProfiler &profiler;
     };
 }
 
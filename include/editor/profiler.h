@@ -0,0 +1,25 @@
+#ifndef RAYMARCHER_PROFILER_H
+#define RAYMARCHER_PROFILER_H
+
+#include <editor/editor_data.h>
+
+#include <string>
+
+namespace editor {
+    // Rolling graphs and percentiles of the frame profiler's passes, and dumps of the trace zones
+    class Profiler {
+        std::string csv_path = "frame_profile.csv";
+        std::string export_status;
+
+        std::string trace_path = "trace.json";
+        std::string trace_status;
+
+        static void pass_graph(std::string_view name, const std::vector<float> &times);
+
+    public:
+        void update(EditorData &state);
+
+    };
+}
+
+#endif //RAYMARCHER_PROFILER_H
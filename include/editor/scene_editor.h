@@ -17,6 +17,12 @@ namespace editor {
 
         void scene_hierarchy(EditorData &state);
 
+        // Indices into the profiler's costs in table order, and the profiled frame they were sorted for
+        std::vector<size_t> cost_order;
+        uint64_t sorted_frame = 0;
+
+        void object_costs(EditorData &state);
+
         void object_editor(EditorData &state);
 
         void scene_editor(EditorData &state);
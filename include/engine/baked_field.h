@@ -0,0 +1,155 @@
+#ifndef RAYMARCHER_BAKED_FIELD_H
+#define RAYMARCHER_BAKED_FIELD_H
+
+#include <engine/bvh.h>
+#include <engine/sdf_program.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Distance to the static groups (SDF_GROUP_STATIC) baked into a sparse grid. The static bounds are split into
+// cells. Cells near a surface get a brick of BRICK_SIZE^3 distance samples spanning the cell corner to corner,
+// which is sampled trilinearly. Every other cell only stores a lower bound of the distance anywhere inside it.
+//
+// The marcher steps by the baked distance and evaluates only the dynamic groups while it is above
+// refine_distance(), and falls back to every group close to static surfaces, so hits, colors and normals stay
+// exact. Mirrored by baked_distance in raymarching_shader.glsl.
+class BakedField {
+public:
+    static constexpr uint32_t BRICK_SIZE = 8;
+    static constexpr uint32_t BRICK_SAMPLES = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static constexpr uint32_t NO_BRICK = 0xFFFFFFFF;
+
+    // The cell size grows past cell_size when the grid would need more cells than this along an axis
+    static constexpr uint32_t MAX_CELLS_PER_AXIS = 128;
+
+    struct Stats {
+        size_t num_full_bakes = 0;
+        size_t num_partial_bakes = 0;
+
+        // Of the last bake
+        double bake_ms = 0;
+        size_t num_baked_cells = 0;
+
+        size_t num_cells = 0;
+        size_t num_bricks = 0;
+        size_t memory_bytes = 0;
+    };
+
+    // Requested edge length of a cell, changing it re-bakes everything
+    float cell_size = 0.5f;
+
+    // Grid origin, actual cell size and cell count per axis
+    glm::vec3 origin{0};
+    float cell = 0;
+    glm::uvec3 dims{0};
+
+    // Union of the static groups' bounds, distances outside the grid are measured to it
+    Aabb bounds = Aabb::empty();
+
+    // Per cell, x fastest: lower bound of the distance in the cell, and the cell's brick or NO_BRICK
+    std::vector<float> coarse;
+    std::vector<uint32_t> bricks;
+
+    // BRICK_SAMPLES per brick slot, x fastest. Freed slots are reused by later bakes.
+    std::vector<float> atlas;
+
+    // What the last update changed, for uploads
+    bool cells_changed = false;
+    std::vector<uint32_t> changed_slots;
+
+    // Bakes the program's static groups. Only the cells near static groups that changed since the last update
+    // are re-baked, unless the static groups were added or removed or outgrew the grid. Returns whether anything
+    // was baked.
+    bool update(const SdfProgram &program);
+
+    void clear();
+
+    [[nodiscard]] bool empty() const { return coarse.empty(); }
+
+    // Lower bound of the distance to the static groups
+    [[nodiscard]] float distance(const glm::vec3 &pos) const;
+
+    // Below this baked distance the static groups have to be evaluated
+    [[nodiscard]] float refine_distance() const;
+
+    // Subtracted from trilinear samples, which can overestimate a 1-Lipschitz distance by up to half a voxel
+    // diagonal
+    [[nodiscard]] float sample_margin() const;
+
+    [[nodiscard]] uint32_t num_slots() const { return static_cast<uint32_t>(atlas.size() / BRICK_SAMPLES); }
+
+    [[nodiscard]] const Stats &stats() const { return bake_stats; }
+
+private:
+    // What a static group looked like when it was baked
+    struct BakedGroup {
+        uint64_t signature;
+        Aabb bounds;
+    };
+
+    std::vector<BakedGroup> baked_groups;
+    std::vector<uint32_t> free_slots;
+    float baked_cell_size = 0;
+
+    // Only the static subtree is ever traversed
+    SceneBvh bvh;
+    std::vector<Aabb> group_bounds;
+
+    Stats bake_stats;
+
+    void bake_all(const SdfProgram &program);
+
+    void bake_cell(const SdfProgram &program, size_t cell_idx);
+
+    [[nodiscard]] Aabb cell_bounds(const glm::uvec3 &cell_pos) const;
+
+    // Exact static distance at pos, or limit when every static group is farther away
+    [[nodiscard]] float static_distance(const SdfProgram &program, const glm::vec3 &pos, float limit) const;
+
+    // Static groups whose bounds lie within reach of box
+    void gather_static(const Aabb &box, float reach, std::vector<uint32_t> &out) const;
+
+    uint32_t allocate_slot();
+
+    void free_slot(uint32_t slot);
+
+    void update_memory_stats();
+};
+
+// The baked field as 3D textures: coarse distances (R32F) and brick indices (R32UI) per cell, and an atlas of
+// bricks ATLAS_BRICKS wide and high with as many layers as needed (R32F, linear filtering).
+class BakedFieldTextures {
+public:
+    static constexpr uint32_t ATLAS_BRICKS = 32;
+
+    // Texture units the shader's baked_ samplers are bound to
+    static constexpr GLuint COARSE_UNIT = 1;
+    static constexpr GLuint BRICKS_UNIT = 2;
+    static constexpr GLuint ATLAS_UNIT = 3;
+
+    Err init();
+
+    // Uploads what the field's last update changed, or everything after the textures had to grow
+    Err upload(const BakedField &field);
+
+    void bind() const;
+
+    [[nodiscard]] size_t memory_bytes() const;
+
+private:
+    GLuint coarse_id = 0;
+    GLuint bricks_id = 0;
+    GLuint atlas_id = 0;
+
+    glm::uvec3 cell_dims{0};
+    uint32_t atlas_layers = 0;
+
+    void upload_slot(const BakedField &field, uint32_t slot) const;
+};
+
+#endif //RAYMARCHER_BAKED_FIELD_H
@@ -0,0 +1,111 @@
+#ifndef RAYMARCHER_BVH_H
+#define RAYMARCHER_BVH_H
+
+#include <engine/sdf_program.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Axis aligned box. Empty boxes have min > max, unbounded ones infinite extents.
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    static Aabb empty();
+
+    static Aabb infinite();
+
+    [[nodiscard]] bool is_empty() const;
+
+    [[nodiscard]] bool is_finite() const;
+
+    [[nodiscard]] Aabb merge(const Aabb &other) const;
+
+    [[nodiscard]] Aabb intersect(const Aabb &other) const;
+
+    // Grown by amount on every side
+    [[nodiscard]] Aabb expand(float amount) const;
+
+    [[nodiscard]] bool contains(const Aabb &other) const;
+
+    [[nodiscard]] glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    [[nodiscard]] float surface_area() const;
+
+    // Zero inside the box
+    [[nodiscard]] float distance(const glm::vec3 &pos) const;
+
+    // Closest distance between the two boxes, zero when they overlap
+    [[nodiscard]] float distance(const Aabb &other) const;
+};
+
+// Conservative world space bounds of every group: the surface where a group's distance reaches zero lies inside
+// its box. Unions merge, subtractions keep the left hand side and intersections clip. Soft unions blend towards
+// the larger distance in this raymarcher, so their merged box stays conservative.
+std::vector<Aabb> compute_group_bounds(const SdfProgram &program);
+
+// Laid out like the std430 BvhNode struct in raymarching_shader.glsl. Leaves reference count items starting at
+// first, inner nodes have count 0 and their children at first and first + 1.
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must match the std430 BvhNode struct in the shader.");
+
+// BVH over the program's groups. Groups without finite bounds (planes, repetition) cannot be culled, they sit at
+// the front of the item list and are evaluated before traversal so the tree is culled against a tight distance.
+//
+// When static groups are separated, they get a subtree of their own under static_root, so marchers that take the
+// static distance from the baked field skip them with a single node.
+class SceneBvh {
+public:
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+    // Must match BVH_STACK_SIZE in the shader. Median splits keep the depth at log2 of the group count.
+    static constexpr uint32_t MAX_DEPTH = 32;
+
+    std::vector<BvhNode> nodes;
+
+    // Group indices, unbounded groups first. Those and every leaf's items are in group order, and so in type run order.
+    std::vector<uint32_t> items;
+    uint32_t num_unbounded = 0;
+
+    // Root of the subtree holding exactly the static groups, or NO_NODE
+    uint32_t static_root = NO_NODE;
+
+    size_t num_builds = 0;
+    size_t num_refits = 0;
+
+    // Refits the existing tree when the groups only moved, rebuilds when groups were added or removed, their
+    // bounds changed between finite and unbounded, they became static or dynamic, or moving them degraded the
+    // tree too much.
+    void update(const SdfProgram &program, bool separate_static = false);
+
+    void clear();
+
+    // Bounds of every group as of the last update
+    [[nodiscard]] const std::vector<Aabb> &group_bounds() const { return bounds; }
+
+private:
+    // Sum of node surface areas right after the last build
+    float built_cost = 0;
+
+    std::vector<Aabb> bounds;
+    std::vector<bool> static_groups;
+
+    void build();
+
+    void build_node(uint32_t node, uint32_t first, uint32_t count);
+
+    void refit();
+
+    [[nodiscard]] float cost() const;
+};
+
+#endif //RAYMARCHER_BVH_H
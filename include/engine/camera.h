@@ -26,6 +26,9 @@ struct Camera {
 
     void rotate(float x_offset, float y_offset);
 
+    // Absolute yaw and pitch in degrees
+    void set_rotation(float new_yaw, float new_pitch);
+
     [[nodiscard]] inline glm::mat4x4 view_matrix() const {
         return glm::lookAt(pos, pos + front, up);
     }
@@ -0,0 +1,73 @@
+#ifndef RAYMARCHER_CONE_PREPASS_H
+#define RAYMARCHER_CONE_PREPASS_H
+
+#include <compute/compute.h>
+#include <compute/readback.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Low resolution cone marching pre-pass. The raymarching shader first runs once per CELL_SIZE^2 block of pixels,
+// marching a cone around the block's rays for as long as no surface can touch it. Full resolution rays then start
+// from the cone's depth instead of the camera.
+//
+// Also counts the steps every pixel takes. Every BASELINE_INTERVAL measurements the pre-pass is skipped for a
+// frame to measure what the steps would be without it. The baseline is put off while the frame runs another one,
+// such as ObjectStaging's, so the two never skip their passes in the same frame.
+class ConePrepass {
+public:
+    static constexpr uint32_t CELL_SIZE = 8;
+    static constexpr uint32_t BASELINE_INTERVAL = 30;
+
+    // Image unit of the depth image, binding of the step counters
+    static constexpr GLuint DEPTH_UNIT = 1;
+    static constexpr GLuint STEPS_BINDING = 9;
+
+    struct Stats {
+        // Mean steps per pixel of the full resolution pass, and of the cones spread over their pixels
+        float steps_per_pixel = 0;
+        float cone_steps_per_pixel = 0;
+
+        // Of the last frame without the pre-pass, every measured frame while it is disabled
+        float baseline_steps_per_pixel = 0;
+    };
+
+    bool enabled = true;
+
+    Err init();
+
+    // Runs the pre-pass with raymarcher, which has to be set up for the frame already, and prepares raymarcher to
+    // start from the cone depths. The full resolution pass has to follow before end_frame(). With defer_baseline a
+    // baseline due this frame moves to the next measured one.
+    Err execute(const compute::ComputeShader &raymarcher, uint32_t width, uint32_t height, uint32_t group_size,
+                bool defer_baseline);
+
+    void end_frame();
+
+    // Read back once the GPU is done with a measured frame, so they lag a frame or two behind
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    GLuint depth_id = 0;
+    GLuint steps_id = 0;
+    glm::uvec2 depth_size{0};
+
+    // Whether the current frame counts steps and runs the cones
+    bool measuring = false;
+    bool ran_cones = false;
+
+    // Signals when the measured frame's step counts are written, only one measured frame is in flight
+    compute::GpuFence stats_fence;
+    bool measured_cones = false;
+    uint32_t num_pixels = 0;
+    uint64_t num_measurements = 0;
+
+    Stats last_stats;
+
+    void read_stats();
+};
+
+#endif //RAYMARCHER_CONE_PREPASS_H
@@ -0,0 +1,127 @@
+#ifndef RAYMARCHER_FRAME_PROFILER_H
+#define RAYMARCHER_FRAME_PROFILER_H
+
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+// Per pass GPU and CPU times of the last HISTORY frames. GPU passes are enclosed in pairs of timestamp queries from a
+// ring of QUERY_FRAMES frames, read back once available and never waited on. A frame whose queries are still pending
+// when its slot in the ring comes around again loses its GPU times. CPU scopes are timed with ScopedTimer.
+class FrameProfiler {
+public:
+    static constexpr size_t HISTORY = 256;
+    static constexpr size_t QUERY_FRAMES = 4;
+
+    enum class GpuPass : uint32_t {
+        Upload, Raymarch, Editor
+    };
+
+    enum class CpuPass : uint32_t {
+        Frame, Setup, Editor
+    };
+
+    static constexpr std::array<std::string_view, 3> GPU_PASS_NAMES = {"Upload & Cull", "Raymarch", "ImGui"};
+    static constexpr std::array<std::string_view, 3> CPU_PASS_NAMES = {"Frame", "Setup", "Editor"};
+
+    static constexpr size_t NUM_GPU_PASSES = GPU_PASS_NAMES.size();
+    static constexpr size_t NUM_CPU_PASSES = CPU_PASS_NAMES.size();
+
+    // In milliseconds, negative for passes that did not run in the frame or whose time was lost
+    struct FrameTimes {
+        uint64_t frame = 0;
+        std::array<float, NUM_GPU_PASSES> gpu{};
+        std::array<float, NUM_CPU_PASSES> cpu{};
+    };
+
+    struct Percentiles {
+        float p50 = 0;
+        float p95 = 0;
+        float p99 = 0;
+        float max = 0;
+    };
+
+    // Adds the time until it goes out of scope to pass of the current frame
+    class ScopedTimer {
+    public:
+        ScopedTimer(FrameProfiler &profiler, CpuPass pass);
+
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer &) = delete;
+
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        FrameProfiler &profiler;
+        CpuPass pass;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Err init();
+
+    // Enclose everything else of a frame
+    void begin_frame();
+
+    void end_frame();
+
+    void begin_gpu(GpuPass pass);
+
+    void end_gpu(GpuPass pass);
+
+    void add_cpu(CpuPass pass, float ms);
+
+    // Times of the finished frames in the history that ran the pass, oldest first
+    [[nodiscard]] std::vector<float> gpu_times(GpuPass pass) const;
+
+    [[nodiscard]] std::vector<float> cpu_times(CpuPass pass) const;
+
+    static Percentiles percentiles(std::vector<float> times);
+
+    // One row per frame in the history, passes without a time are left empty
+    Err export_csv(const std::filesystem::path &path) const;
+
+    // Frames whose GPU times were dropped because their queries were still pending
+    [[nodiscard]] uint64_t num_lost_frames() const { return num_lost; }
+
+private:
+    struct QuerySlot {
+        uint64_t frame = 0;
+        bool pending = false;
+
+        // Begin and end timestamps of every pass
+        std::array<std::array<GLuint, 2>, NUM_GPU_PASSES> query_ids{};
+        std::array<bool, NUM_GPU_PASSES> issued{};
+    };
+
+    std::array<QuerySlot, QUERY_FRAMES> slots;
+    std::array<FrameTimes, HISTORY> history;
+
+    // Index of the current frame, the frames before it are finished on the CPU
+    uint64_t current = 0;
+    bool started = false;
+    std::chrono::steady_clock::time_point frame_start;
+
+    uint64_t num_lost = 0;
+
+    FrameTimes &times_of(uint64_t frame) { return history[frame % HISTORY]; }
+
+    // Oldest frame still in the history
+    [[nodiscard]] uint64_t first_frame() const { return current < HISTORY ? 0 : current - HISTORY + 1; }
+
+    QuerySlot &current_slot() { return slots[current % QUERY_FRAMES]; }
+
+    void read_slot(QuerySlot &slot);
+
+    template<typename F>
+    std::vector<float> finished_times(F &&time) const;
+};
+
+#endif //RAYMARCHER_FRAME_PROFILER_H
@@ -2,20 +2,26 @@
 #define RAYMARCHER_IMAGE_RENDERER_H
 
 #include <utils/err.h>
+#include <utils/image.h>
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include <cstdint>
 
 
 class ImageRenderer {
+    // Of the texture, the raymarcher fills the render_width by render_height corner of it
     GLuint width, height;
+    GLuint render_width, render_height;
     GLuint texture_id;
 
     GLuint vbo, vao, ebo;
 
     GLuint program_id;
 
+    // Compiles and links the blit shaders into program_id
+    Err build_program();
 
 public:
     ImageRenderer(GLuint width, GLuint height);
@@ -24,9 +30,25 @@ public:
 
     void draw() const;
 
-    constexpr GLuint image_width() const { return width; };
+    // Reads the raymarched image back into CPU memory. Stalls until the GPU has finished writing it.
+    Err read_image(Image &image) const;
 
-    constexpr GLuint image_height() const { return height; }
+    // Renders at scale times the texture's resolution from the next frame on, for dynamic resolution
+    void set_render_scale(float scale);
+
+    // Size of the raymarched image
+    constexpr GLuint image_width() const { return render_width; };
+
+    constexpr GLuint image_height() const { return render_height; }
+
+    constexpr GLuint texture_width() const { return width; }
+
+    constexpr GLuint texture_height() const { return height; }
+
+    // Part of the texture covered by the image, in texture coordinates
+    [[nodiscard]] glm::vec2 image_extent() const {
+        return glm::vec2(render_width, render_height) / glm::vec2(width, height);
+    }
 
     [[nodiscard]] constexpr GLuint texture() const { return texture_id; }
 };
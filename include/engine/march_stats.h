@@ -0,0 +1,71 @@
+#ifndef RAYMARCHER_MARCH_STATS_H
+#define RAYMARCHER_MARCH_STATS_H
+
+#include <compute/compute.h>
+#include <compute/readback.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+
+// Work counters of the full resolution raymarching pass. While enabled, every pixel adds its march steps, shadow
+// steps and SDF evaluations, whether it hit, missed or ran out of steps, and its step count into a histogram. Each
+// workgroup sums them in shared memory before adding them to the counter buffer.
+//
+// Frames cycle through the counter buffers of a ReadbackRing, a frame whose buffer is still in flight goes uncounted.
+class MarchStats {
+public:
+    static constexpr GLuint BINDING = 11;
+    static constexpr uint32_t READBACK_FRAMES = 3;
+
+    // Must match the shader, the last bin also holds the pixels that ran out of steps
+    static constexpr uint32_t HISTOGRAM_BINS = 16;
+    static constexpr uint32_t HISTOGRAM_BIN_STEPS = 8;
+
+    struct Stats {
+        // Of the last counted frame
+        uint64_t num_pixels = 0;
+        uint64_t march_steps = 0;
+        uint64_t shadow_steps = 0;
+        uint64_t sdf_evals = 0;
+        uint64_t num_hits = 0;
+        uint64_t num_misses = 0;
+
+        // Missed pixels that stopped at the step limit instead of the maximum distance
+        uint64_t num_exhausted = 0;
+
+        std::array<uint64_t, HISTOGRAM_BINS> step_histogram{};
+
+        uint64_t num_counted_frames = 0;
+    };
+
+    bool enabled = false;
+
+    Err init();
+
+    // Sets up raymarcher to count the passes that follow, up to end_frame()
+    void begin_frame(const compute::ComputeShader &raymarcher);
+
+    void end_frame();
+
+    // A few frames behind the image
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    struct Readback {
+        GLuint buffer_id = 0;
+    };
+
+    compute::ReadbackRing<Readback, READBACK_FRAMES> readbacks;
+
+    // Buffer the current frame counts into, if it is counted
+    Readback *counting = nullptr;
+
+    Stats last_stats;
+
+    void read_stats();
+};
+
+#endif //RAYMARCHER_MARCH_STATS_H
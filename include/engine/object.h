@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 
 #include <expected>
+#include <vector>
 
 enum class ObjectType : uint32_t {
     Empty, Sphere, Box, Torus, InfiniteSpheres, RoundBox, Octohedron, HexPrism, GridPlane
@@ -15,6 +16,25 @@ enum class LinkType : uint32_t {
     Default, SoftUnion, Subtraction, Intersection
 };
 
+// Flattened object as laid out in the ObjectBuffer of raymarching_shader.glsl
+struct ObjectRecord {
+    ObjectType type;
+    glm::vec3 pos;
+    glm::vec3 scale;
+    glm::vec3 color;
+    float diffuse;
+    float specular;
+    LinkType link_type;
+    uint32_t num_children;
+};
+
+static_assert(sizeof(ObjectRecord) == 56, "ObjectRecord must match the std430 Object struct in the shader.");
+
+// Scene files start with the magic and their version. Files from before the header are read as version 0.
+// Version 1 added Object::is_static, version 2 the relaxed marching parameters.
+constexpr uint32_t SCENE_FILE_MAGIC = 0x43534D52;
+constexpr uint32_t SCENE_FILE_VERSION = 2;
+
 struct Object {
     Object() = default;
 
@@ -34,13 +54,27 @@ struct Object {
 
     LinkType link_type = LinkType::Default;
 
+    // Static top level objects are baked into the scene's distance field when baking is enabled, see baked_field.h
+    bool is_static = false;
+
     std::vector<Object> children;
 
+    // Set whenever the object or its children change. Scenes are only recompiled while a flag is set.
+    bool dirty = true;
+
+    // Clears the flags of the object and everything below it, returns whether any was set
+    bool clear_dirty();
+
     std::expected<size_t, Err> write_to_compute_buffer(compute::ComputeBuffer &buf) const;
 
+    // Same depth-first layout as write_to_compute_buffer, for CPU side consumers.
+    size_t write_to_records(std::vector<ObjectRecord> &records) const;
+
+    [[nodiscard]] ObjectRecord to_record() const;
+
     Err write_to_buffer(Buffer &buffer) const;
 
-    Err read_from_buffer(Buffer &buffer);
+    Err read_from_buffer(Buffer &buffer, uint32_t version = SCENE_FILE_VERSION);
 
     constexpr uint32_t uuid() const { return id; };
 
@@ -0,0 +1,89 @@
+#ifndef RAYMARCHER_OBJECT_PROFILER_H
+#define RAYMARCHER_OBJECT_PROFILER_H
+
+#include <compute/compute.h>
+#include <compute/readback.h>
+#include <engine/sdf_program.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Attributes the raymarching work to the objects. The profiling variant of the shader, see
+// ShaderVariants::profile_objects, counts every SDF evaluation of every pass against the evaluated object, and with
+// ARB_shader_clock the clock cycles spent in it. Cycles are approximate, the compiler is free to move work across
+// the clock reads.
+//
+// Counting goes through global atomics for every evaluation, so the variant is much slower than the regular shader.
+// Frames cycle through the buffers of a ReadbackRing like MarchStats, a frame whose buffer is in flight goes uncounted.
+class ObjectProfiler {
+public:
+    // Must match the shader
+    static constexpr GLuint COSTS_BINDING = 12;
+    static constexpr GLuint HEAT_BINDING = 13;
+    static constexpr uint32_t WORDS_PER_OBJECT = 4;
+
+    static constexpr uint32_t READBACK_FRAMES = 3;
+
+    struct ObjectCost {
+        // Object::uuid() of the object
+        uint32_t object_id = 0;
+        uint64_t sdf_evals = 0;
+        uint64_t cycles = 0;
+    };
+
+    struct Stats {
+        // Of the last profiled frame, in the program's object order
+        std::vector<ObjectCost> costs;
+        uint64_t total_evals = 0;
+        uint64_t total_cycles = 0;
+
+        uint64_t num_profiled_frames = 0;
+    };
+
+    // Colors every hit by its group's cost, relative to the most expensive group
+    bool show_heat = false;
+
+    Err init();
+
+    // Sets up raymarcher to count the passes that follow, up to end_frame(). Counts nothing unless raymarcher is the
+    // profiling variant.
+    void begin_frame(const compute::ComputeShader &raymarcher, const SdfProgram &program, bool profiling_shader);
+
+    void end_frame();
+
+    // Cycles are only set with ARB_shader_clock, the costs are a few frames behind the image
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    struct Readback {
+        GLuint buffer_id = 0;
+        size_t capacity = 0;
+
+        // Of the program the frame rendered
+        std::vector<uint32_t> object_ids;
+    };
+
+    compute::ReadbackRing<Readback, READBACK_FRAMES> readbacks;
+
+    // Buffer the current frame counts into, if it is counted
+    Readback *counting = nullptr;
+
+    GLuint heat_id = 0;
+    size_t heat_capacity = 0;
+    std::vector<float> group_heat;
+
+    // Cost of every object of the last profiled frame, cycles when they were measured
+    std::unordered_map<uint32_t, uint64_t> object_cost;
+
+    Stats last_stats;
+
+    void read_stats();
+
+    void upload_heat(const SdfProgram &program);
+};
+
+#endif //RAYMARCHER_OBJECT_PROFILER_H
@@ -0,0 +1,64 @@
+#ifndef RAYMARCHER_OBJECT_STAGING_H
+#define RAYMARCHER_OBJECT_STAGING_H
+
+#include <compute/compute.h>
+#include <compute/readback.h>
+#include <utils/err.h>
+
+#include <cstdint>
+
+// Every workgroup of the raymarching shader copies the first MAX_STAGED_OBJECTS objects' shapes into shared memory
+// once, packed into two vec4s each, and the distance queries read them from there instead of every invocation
+// loading the same records from the object buffer. Objects past the limit are still loaded from the buffer.
+//
+// Also times the raymarching passes. Every BASELINE_INTERVAL measurements staging is skipped for a frame to measure
+// what the passes take with only the object buffer.
+class ObjectStaging {
+public:
+    // Must match MAX_STAGED_OBJECTS in the shader, 16 KB of shared memory
+    static constexpr uint32_t MAX_STAGED_OBJECTS = 512;
+    static constexpr uint32_t BASELINE_INTERVAL = 30;
+
+    struct Stats {
+        uint32_t num_staged = 0;
+        uint32_t num_objects = 0;
+
+        // GPU time of the raymarching passes with and without staging
+        float staged_ms = 0;
+        float baseline_ms = 0;
+    };
+
+    bool enabled = true;
+
+    Err init();
+
+    // Sets up raymarcher to stage the first of num_objects objects and starts timing the passes that follow, up to
+    // end_frame()
+    void begin_frame(const compute::ComputeShader &raymarcher, uint32_t num_objects);
+
+    void end_frame();
+
+    // Read back once the GPU is done with a measured frame, so they lag a frame or two behind
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+    // Whether the current frame skips staging to time the baseline
+    [[nodiscard]] bool running_baseline() const { return baseline; }
+
+private:
+    compute::GpuTimer timer;
+
+    // Whether the current frame is timed and stages objects
+    bool measuring = false;
+    bool staged = false;
+    bool baseline = false;
+
+    // Whether the timed frame in flight staged objects
+    bool measured_staged = false;
+    uint64_t num_measurements = 0;
+
+    Stats last_stats;
+
+    void read_stats();
+};
+
+#endif //RAYMARCHER_OBJECT_STAGING_H
@@ -0,0 +1,36 @@
+#ifndef RAYMARCHER_RENDER_ON_DEMAND_H
+#define RAYMARCHER_RENDER_ON_DEMAND_H
+
+#include <engine/scene.h>
+#include <engine/image_renderer.h>
+
+#include <cstdint>
+
+// Skips raymarching frames that would reproduce the last image. Edits to the objects are caught by their dirty flags,
+// everything else the image depends on, the scene's parameters and camera and the passes' settings, by a hash
+// taken every frame. While nothing changed the renderer keeps showing the last image and only the editor is drawn.
+class RenderOnDemand {
+public:
+    struct Stats {
+        uint64_t num_rendered = 0;
+        uint64_t num_skipped = 0;
+    };
+
+    // Every frame is rendered while disabled
+    bool enabled = true;
+
+    // Whether the frame has to be raymarched, objects_changed when the scene's objects were edited since the last
+    // frame. Counts the frame as rendered or skipped.
+    bool should_render(const Scene &scene, const SceneBuffers &buffers, const ImageRenderer &renderer,
+                       bool objects_changed);
+
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    bool has_image = false;
+    uint64_t last_hash = 0;
+
+    Stats last_stats;
+};
+
+#endif //RAYMARCHER_RENDER_ON_DEMAND_H
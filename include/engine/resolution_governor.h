@@ -0,0 +1,62 @@
+#ifndef RAYMARCHER_RESOLUTION_GOVERNOR_H
+#define RAYMARCHER_RESOLUTION_GOVERNOR_H
+
+#include <compute/readback.h>
+#include <utils/err.h>
+
+#include <cstdint>
+
+// Dynamic resolution. Measures the GPU time of the rendered frames with a GpuTimer and picks the render scale that
+// brings it to target_ms. Times within hysteresis of the target leave the scale alone, and it only moves in
+// SCALE_STEP increments, so the image size settles instead of changing every frame.
+//
+// The time is read back once the GPU finished the frame, so the scale reacts a frame or two late.
+class ResolutionGovernor {
+public:
+    static constexpr float SCALE_STEP = 0.05f;
+
+    struct Stats {
+        // Picked by the last measurement, scale() keeps it within the bounds
+        float scale = 1;
+
+        // Of the last measured frame
+        float gpu_ms = 0;
+        uint64_t num_changes = 0;
+    };
+
+    // Renders at max_scale while disabled
+    bool enabled = true;
+
+    float target_ms = 16.0f;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+
+    // Fraction of the target the time may be off by before the scale changes
+    float hysteresis = 0.15f;
+
+    Err init();
+
+    // Enclose the GPU work of a rendered frame
+    void begin_frame();
+
+    void end_frame();
+
+    // Render scale for the next frame, of the texture's resolution in both dimensions
+    [[nodiscard]] float scale() const;
+
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    compute::GpuTimer timer;
+
+    // Whether the current frame is timed
+    bool measuring = false;
+
+    Stats last_stats;
+
+    void read_time();
+
+    void adjust(float gpu_ms);
+};
+
+#endif //RAYMARCHER_RESOLUTION_GOVERNOR_H
@@ -3,13 +3,130 @@
 
 #include <engine/object.h>
 #include <engine/camera.h>
-#include <compute/buffer.h>
+#include <engine/sdf_program.h>
+#include <engine/bvh.h>
+#include <engine/baked_field.h>
+#include <engine/tile_culler.h>
+#include <engine/cone_prepass.h>
+#include <engine/object_staging.h>
+#include <engine/march_stats.h>
+#include <engine/object_profiler.h>
 #include <compute/compute.h>
+#include <compute/mapped_buffer.h>
 #include <engine/image_renderer.h>
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <cstddef>
+
+// Uniform block binding of SceneParams, must match the raymarching shader
+constexpr GLuint SCENE_PARAMS_BINDING = 0;
+
+// Per frame parameters of the raymarching shader, laid out like its std140 SceneParams block. Every vec3 is
+// followed by a 4 byte member filling its padding, bools are 4 byte uints.
+struct SceneParams {
+    glm::mat4 view;
+    glm::mat4 inv_proj;
+
+    glm::vec3 sky_bottom_color;
+    float fog_dist;
+    glm::vec3 sky_top_color;
+    float shadow_intensity;
+
+    glm::vec3 light_direction;
+    float relaxation;
+    glm::vec3 light_pos;
+    float relaxed_eps;
+    glm::vec3 light_color;
+    uint32_t visualize_distances;
+
+    glm::vec3 baked_origin;
+    float baked_cell;
+    glm::uvec3 baked_dims;
+    float baked_refine_dist;
+    glm::vec3 baked_bounds_min;
+    float baked_sample_margin;
+    glm::vec3 baked_bounds_max;
+    uint32_t use_baked_field;
+
+    uint32_t image_width;
+    uint32_t image_height;
+    uint32_t num_unbounded;
+    uint32_t num_type_runs;
+    uint32_t num_bvh_nodes;
+    uint32_t bvh_static_root;
+    uint32_t use_tile_lists;
+};
+
+static_assert(offsetof(SceneParams, inv_proj) == 64 && offsetof(SceneParams, sky_bottom_color) == 128 &&
+              offsetof(SceneParams, fog_dist) == 140 && offsetof(SceneParams, sky_top_color) == 144 &&
+              offsetof(SceneParams, light_direction) == 160 && offsetof(SceneParams, light_pos) == 176 &&
+              offsetof(SceneParams, light_color) == 192 && offsetof(SceneParams, visualize_distances) == 204 &&
+              offsetof(SceneParams, baked_origin) == 208 && offsetof(SceneParams, baked_dims) == 224 &&
+              offsetof(SceneParams, baked_bounds_min) == 240 && offsetof(SceneParams, baked_bounds_max) == 256 &&
+              offsetof(SceneParams, use_baked_field) == 268 && offsetof(SceneParams, image_width) == 272 &&
+              offsetof(SceneParams, num_bvh_nodes) == 288 && offsetof(SceneParams, use_tile_lists) == 296,
+              "SceneParams must match the std140 SceneParams block in the shader.");
+static_assert(sizeof(SceneParams) == 300, "SceneParams must match the std140 SceneParams block in the shader.");
+
+// GPU buffers the raymarching shader reads the compiled scene from
+struct SceneBuffers {
+    compute::MappedBuffer objects{sizeof(ObjectRecord)};
+    compute::MappedBuffer program{sizeof(uint32_t)};
+    compute::MappedBuffer groups{sizeof(SdfGroup)};
+    compute::MappedBuffer bvh_nodes{sizeof(BvhNode)};
+    compute::MappedBuffer bvh_items{sizeof(uint32_t)};
+    compute::MappedBuffer type_runs{sizeof(SdfTypeRun)};
+
+    // Written as a whole, the parameters change together
+    compute::MappedBuffer params{sizeof(SceneParams), GL_UNIFORM_BUFFER};
+
+    struct UploadStats {
+        // Copied into the buffers by the last frame, and since startup
+        size_t frame_bytes = 0;
+        uint64_t total_bytes = 0;
+
+        // Size of the buffers' contents
+        size_t scene_bytes = 0;
+
+        // Frames that copied nothing at all
+        uint64_t num_skipped_frames = 0;
+    };
+
+    UploadStats uploads;
+
+    // Kept between frames so moving objects only refits it
+    SceneBvh bvh;
+
+    // Static objects are stepped over through the baked field, edits to them only re-bake the cells they touch
+    bool bake_static = false;
+    BakedField baked_field;
+    BakedFieldTextures baked_textures;
+
+    // Primary rays only march against the groups reaching into their screen tile
+    bool cull_tiles = true;
+    TileCuller tile_culler;
+
+    // Full resolution rays start past the empty space found by a low resolution cone march
+    ConePrepass cone_prepass;
+
+    // Workgroups read the objects' shapes from shared memory
+    ObjectStaging object_staging;
+
+    // Counts the raymarching work per pixel while enabled
+    MarchStats march_stats;
+
+    // Attributes the work to the objects while the profiling shader is selected
+    ObjectProfiler object_profiler;
+
+    // The tile culler's shader is loaded from tile_cull_shader_path
+    Err init(const std::filesystem::path &tile_cull_shader_path);
+
+    // Must follow the frame's last dispatch, the buffers' current contents are not overwritten before it finished
+    void end_frame();
+};
+
 struct Scene {
     Camera camera;
     Object root{"Root", ObjectType::Empty, {0, 0, 0}, {1, 1, 1}, {0, 0, 0}};
@@ -24,13 +141,22 @@ struct Scene {
     float shadow_intensity = 0.0;
     bool visualize_distances = false;
 
+    // Over-relaxed sphere tracing: primary rays stretch their steps by this factor and back off when that may have
+    // skipped a surface. 1 marches plainly.
+    float relaxation = 1.0f;
+
+    // Relaxed rays count as hits this close to a surface, then bisect the rest of the way to it
+    float relaxed_eps = 0.04f;
+
     glm::vec3 light_dir = glm::normalize(glm::vec3(-1, -1, 0));
     glm::vec3 light_pos = {30, 30, 0};
     glm::vec3 light_color = glm::vec3(255, 237, 227) / 255.0f;
 
-    Err setup_raymarcher(compute::ComputeShader &raymarcher, compute::ComputeBuffer &object_buffer,
+    Err setup_raymarcher(compute::ComputeShader &raymarcher, const SdfProgram &program, SceneBuffers &buffers,
                          const ImageRenderer &image_renderer) const;
 
+    [[nodiscard]] glm::mat4 projection_matrix(float aspect_ratio) const;
+
     void process_inputs(GLFWwindow *const window, const glm::vec2 &mouse_delta, float delta_time);
 
     Err write_to_buffer(Buffer &buffer) const;
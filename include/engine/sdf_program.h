@@ -0,0 +1,96 @@
+#ifndef RAYMARCHER_SDF_PROGRAM_H
+#define RAYMARCHER_SDF_PROGRAM_H
+
+#include <engine/object.h>
+#include <utils/err.h>
+
+#include <cstdint>
+#include <expected>
+#include <vector>
+
+// The object tree lowered to a flat, register based program. Each top level object becomes a group: a run of
+// instructions that leaves the group's color and distance in register 0. Nested children are evaluated into
+// the next register and folded into their parent with the child's link type, so CSG can nest as deep as
+// there are registers.
+
+enum class SdfOp : uint32_t {
+    // regs[dst] = (color, distance) of objects[arg]
+    Eval,
+    // regs[dst] = combine(regs[dst], regs[arg]), one per LinkType
+    Union, SmoothUnion, Subtract, Intersect
+};
+
+// Must match MAX_REGISTERS in raymarching_shader.glsl
+constexpr uint32_t SDF_MAX_REGISTERS = 16;
+
+// Packed into 32 bits: op in bits 0-3, dst in bits 4-8 and arg in bits 9-31
+struct SdfInstruction {
+    SdfOp op;
+    uint32_t dst;
+    uint32_t arg;
+
+    static constexpr uint32_t MAX_ARG = (1u << 23) - 1;
+
+    [[nodiscard]] constexpr uint32_t encode() const {
+        return static_cast<uint32_t>(op) | (dst << 4) | (arg << 9);
+    }
+
+    [[nodiscard]] static constexpr SdfInstruction decode(const uint32_t code) {
+        return {static_cast<SdfOp>(code & 0xFu), (code >> 4) & 0x1Fu, code >> 9};
+    }
+};
+
+// SdfGroup::flags, must match the GROUP_ constants in raymarching_shader.glsl
+enum SdfGroupFlags : uint32_t {
+    // Top level object is static and the group has finite bounds, so it can be baked
+    SDF_GROUP_STATIC = 1u << 0
+};
+
+struct SdfGroup {
+    uint32_t first_instruction;
+    uint32_t num_instructions;
+
+    // Object whose diffuse and specular are used to shade the group
+    uint32_t material_object;
+    uint32_t flags;
+};
+
+static_assert(sizeof(SdfGroup) == 16, "SdfGroup must match the std430 Group struct in the shader.");
+
+// SdfTypeRun::type of runs whose groups have children, must match RUN_PROGRAM in the shader
+constexpr uint32_t SDF_RUN_PROGRAM = 0xFFFFFFFFu;
+
+// Groups are ordered so that the ones made of a single object come first, sorted by the object's type, and the
+// groups with children follow in scene order. A run covers the consecutive groups of one type, the shader
+// evaluates each run with a loop specialized to its type instead of checking every object's type.
+struct SdfTypeRun {
+    // ObjectType of every group in the run, or SDF_RUN_PROGRAM
+    uint32_t type;
+    uint32_t first_group;
+    uint32_t num_groups;
+
+    // Single object groups of a run evaluate consecutive objects from here
+    uint32_t first_object;
+};
+
+static_assert(sizeof(SdfTypeRun) == 16, "SdfTypeRun must match the std430 TypeRun struct in the shader.");
+
+struct SdfProgram {
+    std::vector<uint32_t> code;
+    std::vector<SdfGroup> groups;
+    std::vector<SdfTypeRun> type_runs;
+
+    // Referenced by Eval, in the order they are evaluated
+    std::vector<ObjectRecord> objects;
+
+    // Object::uuid() of every record, to attribute per object costs back to the scene
+    std::vector<uint32_t> object_ids;
+
+    // Highest register used plus one
+    uint32_t num_registers = 0;
+};
+
+// Empty objects act as folders: their children are compiled as top level groups, in type run order.
+std::expected<SdfProgram, Err> compile_scene(const Object &root);
+
+#endif //RAYMARCHER_SDF_PROGRAM_H
@@ -0,0 +1,32 @@
+#ifndef RAYMARCHER_SHADER_CODEGEN_H
+#define RAYMARCHER_SHADER_CODEGEN_H
+
+#include <engine/sdf_program.h>
+#include <utils/err.h>
+
+#include <cstdint>
+#include <expected>
+#include <string>
+
+// Scene specialized raymarching shaders. The generic shader interprets the SDF program at runtime; a specialized
+// variant replaces query_group_dist, between the SCENE QUERY markers, with straight-line GLSL for one program, with
+// the object types resolved and ops against empty objects folded away. The BVH traversal and the tile lists that call
+// it are left as they are. Object parameters are still read through load_shape, so a variant stays valid for every
+// scene with the same structure.
+//
+// Single object groups are evaluated by the type run loops and never reach query_group_dist, so only the groups with
+// children are generated.
+
+// Programs whose generated groups are above this size are left to the generic shader, their variants take too long
+// to compile
+constexpr size_t MAX_SPECIALIZED_INSTRUCTIONS = 2048;
+
+// Instructions of the groups a variant generates code for, a program without any gains nothing from a variant
+size_t num_specialized_instructions(const SdfProgram &program);
+
+// Hash of everything a specialized variant depends on: instructions, groups and object types
+uint64_t structural_hash(const SdfProgram &program);
+
+std::expected<std::string, Err> specialize_shader(const std::string &generic_source, const SdfProgram &program);
+
+#endif //RAYMARCHER_SHADER_CODEGEN_H
@@ -0,0 +1,76 @@
+#ifndef RAYMARCHER_SHADER_VARIANTS_H
+#define RAYMARCHER_SHADER_VARIANTS_H
+
+#include <compute/compute.h>
+#include <engine/sdf_program.h>
+#include <utils/err.h>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// The generic raymarching shader plus scene specialized variants of it, keyed by the program's structural hash.
+// Parameter edits keep hitting the same variant; a structural edit starts compiling a new one and the generic
+// shader renders until it is ready.
+//
+// The profiling variant is the generic shader with per object cost counters, see object_profiler.h. It is compiled
+// on first use and replaces the others while profile_objects is set.
+class ShaderVariants {
+public:
+    static constexpr size_t MAX_VARIANTS = 8;
+
+    struct Stats {
+        size_t num_compiles = 0;
+        size_t num_failures = 0;
+        bool specialized = false;
+        bool compiling = false;
+        bool profiling = false;
+    };
+
+    bool specialize = true;
+
+    bool profile_objects = false;
+
+    // Also counts clock cycles per object, where ARB_shader_clock is supported
+    bool profile_cycles = false;
+
+    Err init(const std::filesystem::path &shader_path);
+
+    // With wait set, blocks until the variant finished compiling instead of falling back
+    compute::ComputeShader &select(const SdfProgram &program, bool wait = false);
+
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+    [[nodiscard]] size_t size() const { return variants.size(); }
+
+private:
+    struct Variant {
+        compute::ComputeShader shader;
+        bool ready = false;
+        bool failed = false;
+        uint64_t last_used = 0;
+    };
+
+    std::string generic_source;
+    compute::ComputeShader generic;
+
+    std::unordered_map<uint64_t, Variant> variants;
+    uint64_t num_selects = 0;
+    Stats last_stats;
+
+    // Without and with clock cycles
+    std::array<std::optional<Variant>, 2> profiling_variants;
+
+    compute::ComputeShader &select_profiling(bool wait);
+
+    // Polls the variant's compilation, with wait set until it finished. Returns whether the variant can be used.
+    bool finish_compile(Variant &variant, bool wait);
+
+    // Drops the least recently used variant to make room for a new one
+    void evict();
+};
+
+#endif //RAYMARCHER_SHADER_VARIANTS_H
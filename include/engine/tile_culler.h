@@ -0,0 +1,84 @@
+#ifndef RAYMARCHER_TILE_CULLER_H
+#define RAYMARCHER_TILE_CULLER_H
+
+#include <compute/compute.h>
+#include <compute/mapped_buffer.h>
+#include <compute/readback.h>
+#include <engine/bvh.h>
+#include <utils/err.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Screen tile culling pre-pass, see tile_cull_shader.glsl. Every tile of the image gets the list of groups whose
+// bounds reach into the tile's frustum. Primary rays never leave their tile's frustum, so the raymarching shader
+// marches them against only that list, which is in group order. Shadow rays and tiles whose list overflowed use the
+// whole scene.
+class TileCuller {
+public:
+    // Must match the raymarching shader's workgroup size, a workgroup shades exactly one tile
+    static constexpr uint32_t TILE_SIZE = 32;
+
+    // Longer lists overflow, must match MAX_TILE_GROUPS in both shaders
+    static constexpr uint32_t MAX_TILE_GROUPS = 256;
+
+    // Bindings of the tile buffers, shared by both shaders, and of the group bounds in the culling shader
+    static constexpr GLuint COUNTS_BINDING = 6;
+    static constexpr GLuint LISTS_BINDING = 7;
+    static constexpr GLuint BOUNDS_BINDING = 8;
+
+    struct Stats {
+        uint32_t tile_size = TILE_SIZE;
+        uint32_t num_tiles = 0;
+
+        // Groups per tile, overflowing tiles count with their full length
+        float average_groups = 0;
+        uint32_t max_groups = 0;
+        uint32_t num_overflowing = 0;
+    };
+
+    Err init(const std::filesystem::path &shader_path);
+
+    // Culls the groups' bounds, as returned by compute_group_bounds, against every tile of a width by height image
+    // seen through view and inv_proj
+    Err cull(const compute::MappedBuffer &groups, const std::vector<Aabb> &bounds, const glm::mat4 &view,
+             const glm::mat4 &inv_proj, uint32_t width, uint32_t height);
+
+    // Binds the tile lists for the raymarching shader
+    void bind() const;
+
+    // Fences the bounds behind the frame's commands, see MappedBuffer::end_frame()
+    void end_frame();
+
+    // Bounds of the last cull, for the upload statistics
+    [[nodiscard]] const compute::MappedBuffer &bounds_buffer() const { return group_bounds; }
+
+    // List lengths of an earlier cull. Read back once the GPU is done with it, so they lag a frame or two behind.
+    [[nodiscard]] const Stats &stats() const { return last_stats; }
+
+private:
+    compute::ComputeShader shader;
+
+    // Min and max corner of every group as a pair of vec4s, only uploaded when they changed
+    std::vector<glm::vec4> bounds_records;
+    compute::MappedBuffer group_bounds{2 * sizeof(glm::vec4)};
+
+    GLuint counts_id = 0;
+    GLuint lists_id = 0;
+
+    glm::uvec2 num_tiles{0};
+    uint32_t allocated_tiles = 0;
+
+    // Signals when the GPU has written the counts of the cull they are read back from
+    compute::GpuFence stats_fence;
+    std::vector<uint32_t> counts;
+    Stats last_stats;
+
+    void read_stats();
+};
+
+#endif //RAYMARCHER_TILE_CULLER_H
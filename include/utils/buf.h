@@ -55,11 +55,14 @@ public:
 
     Err write(const std::string &val);
 
+    // Raw bytes without a length prefix
+    Err write_bytes(const void *src, size_t count);
+
     template<trivial_type T>
     Err write(const T &val) {
         if (offset + sizeof(T) > data_size) {
             Err result = expand(sizeof(T));
-            if (!result) return result;
+            if (result) return result;
         }
 
         memcpy((void *) (data + offset), (void *) &val, sizeof(T));
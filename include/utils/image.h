@@ -0,0 +1,61 @@
+#ifndef RAYMARCHER_IMAGE_H
+#define RAYMARCHER_IMAGE_H
+
+#include <utils/err.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <vector>
+
+// RGBA float image. Rows are stored bottom-up, matching OpenGL texture and imageStore coordinates.
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<glm::vec4> pixels;
+
+    Image() = default;
+
+    Image(uint32_t width, uint32_t height);
+
+    void resize(uint32_t new_width, uint32_t new_height);
+
+    // Picks the format from the extension: .png, .pfm or .exr
+    Err write_to_file(const std::filesystem::path &path) const;
+
+    // 8 bit RGB, clamped. The raymarcher output is already gamma corrected.
+    Err write_png(const std::filesystem::path &path) const;
+
+    // 32 bit float RGB
+    Err write_pfm(const std::filesystem::path &path) const;
+
+    // 32 bit float RGB with uncompressed scanlines
+    Err write_exr(const std::filesystem::path &path) const;
+
+    [[nodiscard]] constexpr size_t size() const { return static_cast<size_t>(width) * height; }
+
+    [[nodiscard]] inline glm::vec4 &at(const uint32_t x, const uint32_t y) { return pixels[y * width + x]; }
+
+    [[nodiscard]] inline const glm::vec4 &at(const uint32_t x, const uint32_t y) const {
+        return pixels[y * width + x];
+    }
+};
+
+struct ImageDiff {
+    float max_error = 0;
+    float mean_error = 0;
+
+    // Pixels where any channel differs by more than the tolerance
+    size_t num_mismatched = 0;
+    size_t num_pixels = 0;
+
+    [[nodiscard]] constexpr float mismatched_fraction() const {
+        return num_pixels == 0 ? 0.0f : static_cast<float>(num_mismatched) / num_pixels;
+    }
+};
+
+std::expected<ImageDiff, Err> diff_images(const Image &a, const Image &b, float tolerance);
+
+#endif //RAYMARCHER_IMAGE_H
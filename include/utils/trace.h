@@ -0,0 +1,57 @@
+#ifndef RAYMARCHER_TRACE_H
+#define RAYMARCHER_TRACE_H
+
+#include <utils/err.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Scoped trace zones, dumped as Chrome trace JSON for chrome://tracing or Perfetto. Every thread records into its
+// own ring of TRACE_RING_SIZE events. Only that thread writes to its ring, so recording takes no locks, and once a
+// ring is full its oldest events are overwritten.
+//
+// The macros compile to nothing unless RAYMARCHER_TRACE is defined, see the CMake option of the same name. Zone
+// names are not copied, so they must outlive the trace: string literals or __func__.
+
+constexpr size_t TRACE_RING_SIZE = 1 << 14;
+
+#ifdef RAYMARCHER_TRACE
+constexpr bool TRACE_ENABLED = true;
+#else
+constexpr bool TRACE_ENABLED = false;
+#endif
+
+class TraceZone {
+public:
+    explicit TraceZone(const char *name);
+
+    ~TraceZone();
+
+    TraceZone(const TraceZone &) = delete;
+
+    TraceZone &operator=(const TraceZone &) = delete;
+
+private:
+    const char *name;
+    uint64_t begin_ns;
+};
+
+// Names the calling thread in the trace
+void trace_thread_name(std::string_view name);
+
+// Every thread's events still in its ring, threads that exited included
+Err write_chrome_trace(const std::filesystem::path &path);
+
+#ifdef RAYMARCHER_TRACE
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) const TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) trace_thread_name(name)
+#else
+#define TRACE_ZONE(name) static_cast<void>(0)
+#define TRACE_THREAD_NAME(name) static_cast<void>(0)
+#endif
+
+#endif //RAYMARCHER_TRACE_H
@@ -1,12 +1,21 @@
 #include <iostream>
+#include <chrono>
 
 #include <compute/compute.h>
+#include <compute/program_cache.h>
+#include <cpu/raymarcher.h>
 #include <engine/scene.h>
+#include <engine/render_on_demand.h>
+#include <engine/resolution_governor.h>
+#include <engine/frame_profiler.h>
+#include <engine/shader_variants.h>
 #include <engine/image_renderer.h>
 #include <editor/viewport.h>
 #include <editor/scene_editor.h>
+#include <editor/profiler.h>
 #include <editor/editor_data.h>
 #include <editor/imgui_utils.h>
+#include <utils/trace.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -35,11 +44,114 @@ void cursor_pos_callback(GLFWwindow *window, const double xpos, const double ypo
     inputs.prev_mouse_pos = curr_pos;
 }
 
-int main() {
+void run_raymarcher(const Scene &scene, const SdfProgram &program, ShaderVariants &shaders,
+                    SceneBuffers &scene_buffers, const ImageRenderer &renderer, FrameProfiler &profiler,
+                    const bool wait_for_variant = false) {
+    compute::ComputeShader &raymarcher = shaders.select(program, wait_for_variant);
+    raymarcher.activate();
+
+    Err setup_err;
+    profiler.begin_gpu(FrameProfiler::GpuPass::Upload);
+    {
+        const FrameProfiler::ScopedTimer timer(profiler, FrameProfiler::CpuPass::Setup);
+        setup_err = scene.setup_raymarcher(raymarcher, program, scene_buffers, renderer);
+    }
+    profiler.end_gpu(FrameProfiler::GpuPass::Upload);
+    if (setup_err) {
+        setup_err.print();
+        scene_buffers.end_frame();
+        return;
+    }
+
+    // Every workgroup shades one tile of the culling pre-pass
+    constexpr GLuint GROUP_SIZE = TileCuller::TILE_SIZE;
+    profiler.begin_gpu(FrameProfiler::GpuPass::Raymarch);
+    scene_buffers.object_staging.begin_frame(raymarcher, static_cast<uint32_t>(program.objects.size()));
+    scene_buffers.march_stats.begin_frame(raymarcher);
+    scene_buffers.object_profiler.begin_frame(raymarcher, program, shaders.stats().profiling);
+    if (Err err = scene_buffers.cone_prepass.execute(raymarcher, renderer.image_width(), renderer.image_height(),
+                                                     GROUP_SIZE, scene_buffers.object_staging.running_baseline())) {
+        err.print();
+        scene_buffers.march_stats.end_frame();
+        scene_buffers.object_profiler.end_frame();
+        scene_buffers.object_staging.end_frame();
+        profiler.end_gpu(FrameProfiler::GpuPass::Raymarch);
+        scene_buffers.end_frame();
+        return;
+    }
+
+    if (Err err = raymarcher.execute(ceil_divide(renderer.image_width(), GROUP_SIZE),
+                                     ceil_divide(renderer.image_height(), GROUP_SIZE), 1)) {
+        err.print();
+    }
+    scene_buffers.cone_prepass.end_frame();
+    scene_buffers.march_stats.end_frame();
+    scene_buffers.object_profiler.end_frame();
+    scene_buffers.object_staging.end_frame();
+    profiler.end_gpu(FrameProfiler::GpuPass::Raymarch);
+    scene_buffers.end_frame();
+}
+
+// Renders the scene once on the GPU and once with the CPU reference raymarcher, then diffs the two images.
+int validate_cpu_raymarcher(const Scene &scene, ShaderVariants &shaders, SceneBuffers &scene_buffers,
+                            const ImageRenderer &renderer, FrameProfiler &profiler) {
+    // Per channel tolerance, and the share of pixels allowed to exceed it. Silhouettes and shadow
+    // terminators are chaotic under sphere tracing, so a handful of pixels always disagree.
+    constexpr float tolerance = 4.0f / 255.0f;
+    constexpr float max_mismatched_fraction = 0.01f;
+
+    const std::expected<SdfProgram, Err> program = compile_scene(scene.root);
+    if (!program) {
+        program.error().print();
+        return -1;
+    }
+
+    profiler.begin_frame();
+    run_raymarcher(scene, *program, shaders, scene_buffers, renderer, profiler, true);
+    profiler.end_frame();
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    Err err;
+    Image gpu_image;
+    if ((err = renderer.read_image(gpu_image))) {
+        err.print();
+        return -1;
+    }
+
+    cpu::ThreadPool pool;
+    const cpu::Raymarcher cpu_raymarcher(pool);
+    Image cpu_image(renderer.image_width(), renderer.image_height());
+    if ((err = cpu_raymarcher.render(scene, cpu_image))) {
+        err.print();
+        return -1;
+    }
+
+    const std::expected<ImageDiff, Err> diff = diff_images(gpu_image, cpu_image, tolerance);
+    if (!diff) {
+        diff.error().print();
+        return -1;
+    }
+
+    const bool passed = diff->mismatched_fraction() <= max_mismatched_fraction;
+    std::cout << std::format("CPU vs GPU: max error {:.4f}, mean error {:.6f}, {} of {} pixels ({:.3f}%) "
+                             "above tolerance {:.4f}. {}",
+                             diff->max_error, diff->mean_error, diff->num_mismatched, diff->num_pixels,
+                             diff->mismatched_fraction() * 100.0f, tolerance, passed ? "PASSED" : "FAILED")
+              << std::endl;
+
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    const auto startup_begin = std::chrono::steady_clock::now();
+    TRACE_THREAD_NAME("Main");
+    const bool validate_cpu = argc > 1 && std::string_view(argv[1]) == "--validate-cpu";
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (validate_cpu) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow *window = glfwCreateWindow(1600, 900, "Raymarcher", nullptr, nullptr);
     if (!window) {
@@ -73,12 +185,14 @@ int main() {
 
     // Setup Raymarching shader and rendering
     ImageRenderer renderer(1280, 720);
-    compute::ComputeBuffer object_buffer(1024);
-    compute::ComputeShader raymarcher{};
+    SceneBuffers scene_buffers;
+    ShaderVariants shaders;
+    ResolutionGovernor governor;
+    FrameProfiler profiler;
 
     Err err;
-    if ((err = renderer.init()) || (err = object_buffer.init()) ||
-        (err = raymarcher.init(std::filesystem::path("raymarching_shader.glsl")))) {
+    if ((err = renderer.init()) || (err = scene_buffers.init("tile_cull_shader.glsl")) ||
+        (err = shaders.init("raymarching_shader.glsl")) || (err = governor.init()) || (err = profiler.init())) {
         err.print();
         return -1;
     }
@@ -97,9 +211,29 @@ int main() {
         }
     }
 
+    const compute::ProgramCacheStats &cache_stats = compute::program_cache_stats();
+    std::cout << std::format("Startup took {:.1f} ms. Program cache: {} hits, {} misses ({} rejected), "
+                             "{:.1f} ms loading binaries, {:.1f} ms compiling.",
+                             std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - startup_begin).count(),
+                             cache_stats.hits, cache_stats.misses, cache_stats.rejected, cache_stats.load_ms,
+                             cache_stats.compile_ms)
+              << std::endl;
+
+    if (validate_cpu) {
+        const int result = validate_cpu_raymarcher(scene, shaders, scene_buffers, renderer, profiler);
+        glfwTerminate();
+        return result;
+    }
+
     // Setup editor
     editor::Viewport viewport;
     editor::SceneEditor scene_editor;
+    editor::Profiler profiler_window;
+
+    // Compiled again only once the editor changed an object
+    SdfProgram program;
+    RenderOnDemand render_on_demand;
 
     // Render loop
     float last_frame_time = static_cast<float>(glfwGetTime());
@@ -108,6 +242,8 @@ int main() {
         const float current_frame_time = static_cast<float>(glfwGetTime());
         const float delta_time = current_frame_time - last_frame_time;
         last_frame_time = current_frame_time;
+        profiler.begin_frame();
+        TRACE_ZONE("Frame");
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
@@ -123,25 +259,44 @@ int main() {
         ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), ImGuiDockNodeFlags_PassthruCentralNode);
 
         // Run raymarcher
-        raymarcher.activate();
-        scene.setup_raymarcher(raymarcher, object_buffer, renderer);
-
-        constexpr GLuint GROUP_SIZE = 32;
-        raymarcher.execute(ceil_divide(renderer.image_width(), GROUP_SIZE),
-                           ceil_divide(renderer.image_height(), GROUP_SIZE), 1);
+        const bool objects_changed = scene.root.clear_dirty();
+        if (objects_changed) {
+            if (std::expected<SdfProgram, Err> compiled = compile_scene(scene.root)) {
+                program = std::move(*compiled);
+            } else {
+                compiled.error().print();
+            }
+        }
+        renderer.set_render_scale(governor.scale());
+        // Profiling measures every frame
+        if (render_on_demand.should_render(scene, scene_buffers, renderer,
+                                           objects_changed || shaders.profile_objects)) {
+            governor.begin_frame();
+            run_raymarcher(scene, program, shaders, scene_buffers, renderer, profiler);
+            governor.end_frame();
+        }
 
         // Make sure writing to image has finished before rendering
         glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         // Update editor.
-        editor::EditorData editor_data{window, delta_time, scene, inputs, renderer};
-        viewport.update(editor_data);
-        scene_editor.update(editor_data);
+        editor::EditorData editor_data{window, delta_time, scene, inputs, renderer, shaders, scene_buffers,
+                                       render_on_demand, governor, profiler};
+        {
+            TRACE_ZONE("Editor update");
+            const FrameProfiler::ScopedTimer timer(profiler, FrameProfiler::CpuPass::Editor);
+            viewport.update(editor_data);
+            scene_editor.update(editor_data);
+            profiler_window.update(editor_data);
+        }
 
         // Render ImGUI
         ImGui::Render();
+        profiler.begin_gpu(FrameProfiler::GpuPass::Editor);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.end_gpu(FrameProfiler::GpuPass::Editor);
+        profiler.end_frame();
 
         // Swap buffers
         glfwSwapBuffers(window);
@@ -15,11 +15,15 @@ const uint Octohedron = 6u;
 const uint HexPrism = 7u;
 const uint GridPlane = 8u;
 
-// Link types
-const uint Default = 0u;
-const uint SoftUnion = 1u;
-const uint Subtraction = 2u;
-const uint Intersection = 3u;
+// Program ops, see sdf_program.h
+const uint Eval = 0u;
+const uint Union = 1u;
+const uint SmoothUnion = 2u;
+const uint Subtract = 3u;
+const uint Intersect = 4u;
+
+// Must match SDF_MAX_REGISTERS
+const uint MAX_REGISTERS = 16u;
 
 // Buffer of objects
 struct Object {
@@ -40,26 +44,233 @@ layout(std430, binding = 1) buffer ObjectBuffer
     Object[] objects;
 } object_buffer;
 
+// Compiled scene program, one packed instruction per uint
+layout(std430, binding = 2) buffer ProgramBuffer
+{
+    uint[] code;
+} program_buffer;
+
+// Each group is a run of instructions leaving its result in register 0
+struct Group {
+    uint first_instruction;
+    uint num_instructions;
+    uint material_object;
+    uint flags;
+};
 
-// Uniforms
-uniform mat4x4 view;
-uniform mat4x4 inv_proj;
+// Group flags, must match SdfGroupFlags
+const uint GROUP_STATIC = 1u;
+
+layout(std430, binding = 3) buffer GroupBuffer
+{
+    Group[] groups;
+} group_buffer;
+
+// BVH over the groups, see bvh.h. Leaves reference count items from first, inner nodes have count 0 and their
+// children at first and first + 1.
+struct BvhNode {
+    vec3 bmin;
+    uint first;
+    vec3 bmax;
+    uint count;
+};
+
+layout(std430, binding = 4) buffer BvhBuffer
+{
+    BvhNode[] nodes;
+} bvh_buffer;
+
+// Group indices referenced by the leaves, preceded by the unbounded groups
+layout(std430, binding = 5) buffer BvhItemBuffer
+{
+    uint[] items;
+} bvh_item_buffer;
+
+// Consecutive groups of one object type, see SdfTypeRun
+struct TypeRun {
+    uint type;
+    uint first_group;
+    uint num_groups;
+    uint first_object;
+};
 
-uniform uint image_width;
-uniform uint image_height;
-uniform uint num_objects;
+// Must match SDF_RUN_PROGRAM, runs of groups with children
+const uint RUN_PROGRAM = 0xFFFFFFFFu;
 
-uniform vec3 sky_bottom_color;
-uniform vec3 sky_top_color;
-uniform float fog_dist;
-uniform float shadow_intensity;
+layout(std430, binding = 10) buffer TypeRunBuffer
+{
+    TypeRun[] runs;
+} type_run_buffer;
+
+// Must match SceneBvh::MAX_DEPTH
+const uint BVH_STACK_SIZE = 32u;
+
+// Static groups baked into a sparse grid, see baked_field.h. Per cell a lower bound of the distance and a brick
+// index, and an atlas of bricks whose samples sit on their cell's corners.
+layout(binding = 1) uniform sampler3D baked_coarse;
+layout(binding = 2) uniform usampler3D baked_bricks;
+layout(binding = 3) uniform sampler3D baked_atlas;
+
+// Must match BakedField and BakedFieldTextures
+const uint BAKED_NO_BRICK = 0xFFFFFFFFu;
+const uint BAKED_BRICK_SIZE = 8u;
+const uint BAKED_ATLAS_BRICKS = 32u;
+
+// Per screen tile lists of the groups reaching into the tile, written by tile_cull_shader.glsl. Entries are group
+// indices, with TILE_STATIC_BIT set for static groups.
+layout(std430, binding = 6) buffer TileCountBuffer
+{
+    uint[] counts;
+} tile_count_buffer;
 
-uniform bool visualize_distances;
+layout(std430, binding = 7) buffer TileListBuffer
+{
+    uint[] entries;
+} tile_list_buffer;
 
-// temp directional light
-uniform vec3 light_direction;
-uniform vec3 light_pos;
-uniform vec3 light_color;
+// Must match TileCuller, tiles are exactly one workgroup
+const uint MAX_TILE_GROUPS = 256u;
+const uint TILE_STATIC_BIT = 0x80000000u;
+
+// The workgroup's tile list, staged once per invocation of the shader
+shared uint tile_groups[MAX_TILE_GROUPS];
+shared uint tile_num_groups;
+
+// Cone pre-pass depths, one per cone_cell_size^2 block of pixels, see cone_prepass.h
+layout(r32f, binding = 1) uniform image2D cone_depth;
+
+// Steps taken by every pixel of the full resolution pass, and by the cones
+layout(std430, binding = 9) buffer StepCountBuffer
+{
+    uint march_steps;
+    uint cone_steps;
+} step_counts;
+
+shared uint group_steps;
+
+// Work counters of the full resolution pass, see march_stats.h. Every counter is a low and a high word, the
+// histogram of steps per pixel follows the counters.
+const uint MARCH_STEPS = 0u;
+const uint SHADOW_STEPS = 1u;
+const uint SDF_EVALS = 2u;
+const uint HITS = 3u;
+const uint MISSES = 4u;
+const uint EXHAUSTED = 5u;
+const uint NUM_MARCH_COUNTERS = 6u;
+const uint HISTOGRAM_BINS = 16u;
+const uint HISTOGRAM_BIN_STEPS = 8u;
+
+layout(std430, binding = 11) buffer MarchStatsBuffer
+{
+    uint words[];
+} march_stats;
+
+shared uint group_march_stats[NUM_MARCH_COUNTERS + HISTOGRAM_BINS];
+
+// Counted by the invocation's queries and shadow rays
+uint sdf_evals = 0u;
+uint shadow_steps = 0u;
+
+// Per object costs of the profiling variant, see object_profiler.h. ShaderVariants defines PROFILE_OBJECTS, and
+// PROFILE_CYCLES to read clocks. Every object has four words: evaluations, then the cycles' low and high word.
+#ifdef PROFILE_OBJECTS
+layout(std430, binding = 12) buffer ObjectCostBuffer
+{
+    uint words[];
+} object_costs;
+
+// Cost of every group relative to the most expensive one
+layout(std430, binding = 13) buffer GroupHeatBuffer
+{
+    float heat[];
+} group_heat;
+
+uniform bool count_object_costs;
+uniform bool show_cost_heat;
+
+void add_object_cost(in uint idx, in uint cycles) {
+    if (!count_object_costs) return;
+
+    atomicAdd(object_costs.words[4u * idx], 1u);
+    if (cycles == 0u) return;
+
+    const uint low = atomicAdd(object_costs.words[4u * idx + 1u], cycles);
+    if (low + cycles < low) atomicAdd(object_costs.words[4u * idx + 2u], 1u);
+}
+
+#if defined(PROFILE_CYCLES) && defined(GL_ARB_shader_clock)
+#define BEGIN_OBJECT_COST() const uint cost_start = clock2x32ARB().x;
+#define END_OBJECT_COST(IDX) add_object_cost(IDX, clock2x32ARB().x - cost_start);
+#else
+#define BEGIN_OBJECT_COST()
+#define END_OBJECT_COST(IDX) add_object_cost(IDX, 0u);
+#endif
+
+// Blue for cheap through green and yellow to red for the most expensive
+vec3 heat_color(in float heat) {
+    const float t = clamp(heat, 0.0, 1.0);
+    return clamp(1.5 - abs(4 * t - vec3(3, 2, 1)), 0.0, 1.0);
+}
+#else
+#define BEGIN_OBJECT_COST()
+#define END_OBJECT_COST(IDX)
+#endif
+
+// Shapes of the first objects, staged by every workgroup, see object_staging.h and load_shape. Two vec4s per
+// object: position and type, then scale.
+const uint MAX_STAGED_OBJECTS = 512u;
+shared vec4 staged_shapes[2 * MAX_STAGED_OBJECTS];
+
+
+// Uniforms
+// Written once per frame by Scene::setup_raymarcher, must match SceneParams
+layout(std140, binding = 0) uniform SceneParams
+{
+    mat4x4 view;
+    mat4x4 inv_proj;
+
+    vec3 sky_bottom_color;
+    float fog_dist;
+    vec3 sky_top_color;
+    float shadow_intensity;
+
+    // temp directional light
+    vec3 light_direction;
+    // Over-relaxed sphere tracing of primary rays, off at 1
+    float relaxation;
+    vec3 light_pos;
+    float relaxed_eps;
+    vec3 light_color;
+    bool visualize_distances;
+
+    vec3 baked_origin;
+    float baked_cell;
+    uvec3 baked_dims;
+    float baked_refine_dist;
+    vec3 baked_bounds_min;
+    float baked_sample_margin;
+    vec3 baked_bounds_max;
+    bool use_baked_field;
+
+    uint image_width;
+    uint image_height;
+    uint num_unbounded;
+    uint num_type_runs;
+    uint num_bvh_nodes;
+    // Subtree holding the static groups, see SceneBvh::static_root
+    uint bvh_static_root;
+    bool use_tile_lists;
+};
+
+// Set by the passes between dispatches
+// Objects below this index are read from staged_shapes
+uniform uint num_staged_objects;
+
+uniform bool cone_pass;
+uniform bool use_cone_depth;
+uniform uint cone_cell_size;
+uniform bool count_steps;
+uniform bool count_march_stats;
 
 
 // Constants
@@ -69,6 +280,9 @@ const float max_dist = 100.0;
 const float eps = 0.01;
 const float max_steps = 128;
 
+// Spacing of the samples estimating gradients without a closed form, must match GRADIENT_EPS in sdf.h
+const float gradient_eps = 0.001;
+
 const float shadow_eps = 0.01;
 const float shadow_max_steps = 64;
 const float shadow_max_dist = 50.0;
@@ -134,6 +348,47 @@ float sdPlane(vec3 p, vec3 n, float h)
     return dot(p, n) + h;
 }
 
+// Analytic gradients of the distance functions, returned as vec4(gradient, distance). The CPU port gets the same
+// ones by running its distance functions on dual numbers, see dual.h.
+vec4 sdgSphere(vec3 p, float s)
+{
+    float l = length(p);
+    return vec4(l > 0.0 ? p/l : vec3(0), l-s);
+}
+
+vec4 sdgBox(vec3 p, vec3 b)
+{
+    vec3 w = abs(p) - b;
+    vec3 s = vec3(p.x < 0.0 ? -1 : 1, p.y < 0.0 ? -1 : 1, p.z < 0.0 ? -1 : 1);
+    float g = max(w.x, max(w.y, w.z));
+    vec3 q = max(w, 0.0);
+    float l = length(q);
+
+    // Outside along the closest point, inside along the nearest face's normal
+    if (g > 0.0) return vec4(s*q/l, l);
+    return vec4(s*(w.x == g ? vec3(1, 0, 0) : w.y == g ? vec3(0, 1, 0) : vec3(0, 0, 1)), g);
+}
+
+vec4 sdgTorus(vec3 p, vec2 t)
+{
+    float r = length(p.xz);
+    vec2 q = vec2(r-t.x, p.y);
+    float l = length(q);
+    vec3 dr = r > 0.0 ? vec3(p.x, 0, p.z)/r : vec3(0);
+    return vec4(l > 0.0 ? (q.x*dr + vec3(0, q.y, 0))/l : vec3(0), l-t.y);
+}
+
+vec4 sdgInfiniteSpheres(vec3 p, vec3 s)
+{
+    return sdgSphere(p - s*round(p/s), 1);
+}
+
+vec4 sdgRoundBox(vec3 p, vec3 b, float r)
+{
+    vec4 g = sdgBox(p, b - r);
+    return vec4(g.xyz, g.w - r);
+}
+
 // Select distance function based on object type
 float find_distance_to_object(Object curr, vec3 pos) {
     vec3 obj_pos = vec3(curr.x, curr.y, curr.z);
@@ -177,6 +432,56 @@ float find_distance_to_object(Object curr, vec3 pos) {
     return MAX;
 }
 
+// Gradient from four samples on a tetrahedron around pos, the distance is their mean
+vec4 estimate_object_gradient(Object curr, vec3 pos) {
+    const vec2 k = vec2(1, -1);
+    const float a = find_distance_to_object(curr, pos + k.xyy*gradient_eps);
+    const float b = find_distance_to_object(curr, pos + k.yyx*gradient_eps);
+    const float c = find_distance_to_object(curr, pos + k.yxy*gradient_eps);
+    const float d = find_distance_to_object(curr, pos + k.xxx*gradient_eps);
+
+    return vec4((k.xyy*a + k.yyx*b + k.yxy*c + k.xxx*d) / (4*gradient_eps), (a + b + c + d) * 0.25);
+}
+
+// find_distance_to_object with its gradient with respect to pos, as vec4(gradient, distance). Octahedra and
+// hexagonal prisms have no closed form gradient.
+vec4 find_gradient_to_object(Object curr, vec3 pos) {
+    vec3 p = vec3(curr.x, curr.y, curr.z) - pos;
+
+    // p points from pos to the object, which flips the gradients
+    const vec4 flip = vec4(-1, -1, -1, 1);
+
+    if (curr.type == Sphere) {
+        return flip * sdgSphere(p, curr.sx);
+    }
+
+    if (curr.type == Box) {
+        return flip * sdgBox(p, vec3(curr.sx, curr.sy, curr.sz));
+    }
+
+    if (curr.type == Torus) {
+        return flip * sdgTorus(p, vec2(curr.sx, curr.sy));
+    }
+
+    if (curr.type == InfiniteSpheres) {
+        return flip * sdgInfiniteSpheres(p, vec3(curr.sx, curr.sy, curr.sz));
+    }
+
+    if (curr.type == RoundBox) {
+        return flip * sdgRoundBox(p, vec3(curr.sx, curr.sy, curr.sz), 0.1);
+    }
+
+    if (curr.type == Octohedron || curr.type == HexPrism) {
+        return estimate_object_gradient(curr, pos);
+    }
+
+    if (curr.type == GridPlane) {
+        return vec4(0, 1, 0, sdPlane(pos, vec3(0, 1, 0), -curr.y));
+    }
+
+    return vec4(0, 0, 0, MAX);
+}
+
 // combination functions
 vec4 smooth_min(vec4 a, vec4 b, float k)
 {
@@ -212,33 +517,95 @@ vec3 get_object_color(in Object obj, in vec3 pos) {
     return vec3(obj.r, obj.g, obj.b);
 }
 
-vec4 combined_query(in vec4 curr_data, in Object other, in vec3 pos) {
-    const uint link_type = other.link_type;
-    float other_dist = find_distance_to_object(other, pos);
-    vec4 other_data = vec4(get_object_color(other, pos), other_dist);
-
-    if (link_type == Default) {
+vec4 combine(in uint op, in vec4 curr_data, in vec4 other_data) {
+    if (op == Union) {
         if (curr_data.w < other_data.w) {
             return curr_data;
         }
         return other_data;
     }
 
-    if (link_type == SoftUnion) {
+    if (op == SmoothUnion) {
         return smooth_min(curr_data, other_data, 10);
     }
 
-    if (link_type == Subtraction) {
+    if (op == Subtract) {
         return subtraction(curr_data, other_data);
     }
 
-    if (link_type == Intersection) {
+    if (op == Intersect) {
         return intersection(curr_data, other_data);
     }
 
     return curr_data;
 }
 
+// Distance part of smooth_min, which blends whole vec4s
+float smooth_min_dist(float a, float b, float k)
+{
+    float h = max(k-abs(a-b), 0.0)/k;
+    float m = h*h*0.5;
+    float blend = (a<b) ? m : 1.0-m;
+
+    return (1-blend)*a + blend*b;
+}
+
+// Distance part of combine, for marching
+float combine_dist(in uint op, in float curr_dist, in float other_dist) {
+    if (op == Union) {
+        return curr_dist < other_dist ? curr_dist : other_dist;
+    }
+
+    if (op == SmoothUnion) {
+        return smooth_min_dist(curr_dist, other_dist, 10);
+    }
+
+    if (op == Subtract) {
+        return max(-other_dist, curr_dist);
+    }
+
+    if (op == Intersect) {
+        return max(curr_dist, other_dist);
+    }
+
+    return curr_dist;
+}
+
+// smooth_min on vec4(gradient, distance), the blend factor depends on both distances and is differentiated too
+vec4 smooth_min_gradient(vec4 a, vec4 b, float k)
+{
+    float h = max(k-abs(a.w-b.w), 0.0)/k;
+    float m = h*h*0.5;
+    float blend = (a.w<b.w) ? m : 1.0-m;
+
+    // d(blend) = +-h*dh, where dh = -sign(a-b)*(grad a - grad b)/k while h > 0
+    vec3 dh = h > 0.0 ? -sign(a.w-b.w) * (a.xyz-b.xyz) / k : vec3(0);
+    vec3 dblend = ((a.w<b.w) ? h : -h) * dh;
+
+    return vec4((1-blend)*a.xyz + blend*b.xyz + (b.w-a.w)*dblend, (1-blend)*a.w + blend*b.w);
+}
+
+// combine on vec4(gradient, distance) registers, picking the gradient of whichever side the op's max or min picks
+vec4 combine_gradient(in uint op, in vec4 curr_data, in vec4 other_data) {
+    if (op == Union) {
+        return curr_data.w < other_data.w ? curr_data : other_data;
+    }
+
+    if (op == SmoothUnion) {
+        return smooth_min_gradient(curr_data, other_data, 10);
+    }
+
+    if (op == Subtract) {
+        return -other_data.w < curr_data.w ? curr_data : -other_data;
+    }
+
+    if (op == Intersect) {
+        return curr_data.w < other_data.w ? other_data : curr_data;
+    }
+
+    return curr_data;
+}
+
 
 
 vec3 get_ray_origin() {
@@ -252,61 +619,270 @@ vec3 get_ray_direction(in vec2 uv) {
     return dir;
 }
 
-vec4 query_object(in uint idx, in vec3 pos) {
-    Object curr = object_buffer.objects[idx];
-    const bool linked =  curr.type != Placeholder;
+float box_distance(in vec3 pos, in vec3 bmin, in vec3 bmax) {
+    return length(max(max(bmin - pos, pos - bmax), 0.0));
+}
 
-    vec4 curr_data = vec4(get_object_color(curr, pos), find_distance_to_object(curr, pos));
+// Lower bound of the distance to the static groups
+float baked_distance(in vec3 pos) {
+    const vec3 local = (pos - baked_origin) / baked_cell;
+    if (any(lessThan(local, vec3(0))) || any(greaterThanEqual(local, vec3(baked_dims)))) {
+        return box_distance(pos, baked_bounds_min, baked_bounds_max);
+    }
 
-    if (linked) {
-        for (uint c = 1; c <= curr.num_children; c++) {
-            curr_data = combined_query(curr_data, object_buffer.objects[idx+c], pos);
+    const ivec3 cell = ivec3(local);
+    const uint brick = texelFetch(baked_bricks, cell, 0).r;
+    if (brick == BAKED_NO_BRICK) {
+        return texelFetch(baked_coarse, cell, 0).r;
+    }
+
+    // Texel centers of the brick's samples span the cell exactly, so the hardware filter interpolates within it
+    const uvec3 slot = uvec3(brick % BAKED_ATLAS_BRICKS, (brick / BAKED_ATLAS_BRICKS) % BAKED_ATLAS_BRICKS,
+                             brick / (BAKED_ATLAS_BRICKS * BAKED_ATLAS_BRICKS));
+    const vec3 texel = vec3(slot * BAKED_BRICK_SIZE) + 0.5 + (local - vec3(cell)) * float(BAKED_BRICK_SIZE - 1u);
+    return texture(baked_atlas, texel / vec3(textureSize(baked_atlas, 0))).r - baked_sample_margin;
+}
+
+// Interprets a group's instructions, returning its color and distance. Marching and shadows only carry distances,
+// the color is resolved with this once per hit.
+vec4 query_group(in uint idx, in vec3 pos) {
+    const Group group = group_buffer.groups[idx];
+    vec4 regs[MAX_REGISTERS];
+
+    for (uint i = 0; i < group.num_instructions; i++) {
+        const uint inst = program_buffer.code[group.first_instruction + i];
+        const uint op = inst & 0xFu;
+        const uint dst = (inst >> 4) & 0x1Fu;
+        const uint arg = inst >> 9;
+
+        if (op == Eval) {
+            Object curr = object_buffer.objects[arg];
+            BEGIN_OBJECT_COST()
+            regs[dst] = vec4(get_object_color(curr, pos), find_distance_to_object(curr, pos));
+            END_OBJECT_COST(arg)
+            sdf_evals++;
+        } else {
+            regs[dst] = combine(op, regs[dst], regs[arg]);
         }
     }
 
-    return curr_data;
+    return regs[0];
+}
+
+// Object for the distance functions, from shared memory when it was staged. Only its type, position and scale are
+// set.
+Object load_shape(in uint idx) {
+    if (idx >= num_staged_objects) return object_buffer.objects[idx];
+
+    const vec4 a = staged_shapes[2 * idx];
+    const vec4 b = staged_shapes[2 * idx + 1];
+
+    Object o;
+    o.type = uint(a.w);
+    o.x = a.x;
+    o.y = a.y;
+    o.z = a.z;
+    o.sx = b.x;
+    o.sy = b.y;
+    o.sz = b.z;
+    return o;
 }
 
-void query_scene(in vec3 pos, out vec3 color, out float min_dist, out uint hit_idx) {
-    color = vec3(0, 0, 0);
-    min_dist = MAX;
+// Consumes the entries of ENTRIES up to END whose groups lie in the run, every one a single object group of the run's
+// type. An entry is a group index, with STATIC_BIT set for static groups. The object's shape is o and its offset from
+// pos is p when DIST is evaluated.
+#define QUERY_RUN(DIST, END, ENTRIES, STATIC_BIT) \
+    for (; i < END; i++) { \
+        const uint entry = ENTRIES[i]; \
+        const uint idx = entry & ~STATIC_BIT; \
+        if (idx >= run_end) break; \
+        if (skip_static && (entry & STATIC_BIT) != 0u) continue; \
+        const uint object_idx = run.first_object + idx - run.first_group; \
+        const Object o = load_shape(object_idx); \
+        const vec3 p = vec3(o.x, o.y, o.z) - pos; \
+        BEGIN_OBJECT_COST() \
+        const float dist = DIST; \
+        END_OBJECT_COST(object_idx) \
+        sdf_evals++; \
+        if (dist < min_dist) { \
+            min_dist = dist; \
+            hit_idx = idx; \
+        } \
+    }
+
+// Walks the entries from FIRST to END, which are in group order, run by run. Every run of single object groups is a
+// loop without type checks, groups with children run their program. Types without a distance are never hit and their
+// entries are skipped.
+#define QUERY_RUNS(FIRST, END, ENTRIES, STATIC_BIT) { \
+    uint i = FIRST; \
+    for (uint r = 0; r < num_type_runs && i < END; r++) { \
+        const TypeRun run = type_run_buffer.runs[r]; \
+        const uint run_end = run.first_group + run.num_groups; \
+        if ((ENTRIES[i] & ~STATIC_BIT) >= run_end) continue; \
+        if (run.type == Sphere) { \
+            QUERY_RUN(sdSphere(p, o.sx), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == Box) { \
+            QUERY_RUN(sdBox(p, vec3(o.sx, o.sy, o.sz)), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == Torus) { \
+            QUERY_RUN(sdTorus(p, vec2(o.sx, o.sy)), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == InfiniteSpheres) { \
+            QUERY_RUN(sdInfiniteSpheres(p, vec3(o.sx, o.sy, o.sz)), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == RoundBox) { \
+            QUERY_RUN(sdRoundBox(p, vec3(o.sx, o.sy, o.sz), 0.1), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == Octohedron) { \
+            QUERY_RUN(sdOctahedron(p, o.sx), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == HexPrism) { \
+            QUERY_RUN(sdHexPrism(p, vec2(o.sx, o.sy)), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == GridPlane) { \
+            QUERY_RUN(sdPlane(pos, vec3(0, 1, 0), -o.y), END, ENTRIES, STATIC_BIT) \
+        } else if (run.type == RUN_PROGRAM) { \
+            for (; i < END; i++) { \
+                const uint entry = ENTRIES[i]; \
+                const uint idx = entry & ~STATIC_BIT; \
+                if (idx >= run_end) break; \
+                if (skip_static && (entry & STATIC_BIT) != 0u) continue; \
+                const float dist = query_group_dist(idx, pos); \
+                if (dist < min_dist) { \
+                    min_dist = dist; \
+                    hit_idx = idx; \
+                } \
+            } \
+        } \
+        while (i < END && (ENTRIES[i] & ~STATIC_BIT) < run_end) i++; \
+    } \
+}
+
+// SCENE QUERY BEGIN - specialized variants replace this block, see shader_codegen.h
+// Interprets a group's instructions for its distance only
+float query_group_dist(in uint idx, in vec3 pos) {
+    const Group group = group_buffer.groups[idx];
+    float regs[MAX_REGISTERS];
+
+    for (uint i = 0; i < group.num_instructions; i++) {
+        const uint inst = program_buffer.code[group.first_instruction + i];
+        const uint op = inst & 0xFu;
+        const uint dst = (inst >> 4) & 0x1Fu;
+        const uint arg = inst >> 9;
+
+        if (op == Eval) {
+            BEGIN_OBJECT_COST()
+            regs[dst] = find_distance_to_object(load_shape(arg), pos);
+            END_OBJECT_COST(arg)
+            sdf_evals++;
+        } else {
+            regs[dst] = combine_dist(op, regs[dst], regs[arg]);
+        }
+    }
+
+    return regs[0];
+}
+// SCENE QUERY END
+
+// Closest group to pos that beats start_dist. With skip_static the static groups are left out, the baked field
+// stands in for them.
+void query_groups(in vec3 pos, in float start_dist, in bool skip_static, out float min_dist, out uint hit_idx) {
+    min_dist = start_dist;
     hit_idx = 0;
 
-    for (uint i = 0; i < num_objects; i++) {
-        Object curr = object_buffer.objects[i];
-        const bool linked =  curr.type != Placeholder;
-        vec4 curr_data = query_object(i, pos);
+    // Unbounded groups first, they usually give a tight distance to cull the tree with. They and every leaf's items are
+    // in group order. The static subtree is skipped whole, so no entry is marked static.
+    QUERY_RUNS(0u, num_unbounded, bvh_item_buffer.items, 0u)
+
+    if (num_bvh_nodes == 0) return;
+
+    // Skip subtrees whose bounds are farther away than the closest group so far
+    uint stack[BVH_STACK_SIZE];
+    uint stack_size = 1;
+    stack[0] = 0;
+
+    while (stack_size > 0) {
+        const uint node_idx = stack[--stack_size];
+        if (skip_static && node_idx == bvh_static_root) continue;
+
+        const BvhNode node = bvh_buffer.nodes[node_idx];
+        if (box_distance(pos, node.bmin, node.bmax) >= min_dist) continue;
 
-        if (curr_data.w < min_dist) {
-            min_dist = curr_data.w;
-            color = curr_data.rgb;
-            hit_idx = i;
+        if (node.count > 0) {
+            QUERY_RUNS(node.first, node.first + node.count, bvh_item_buffer.items, 0u)
+            continue;
         }
 
-        if (linked) {
-            i += curr.num_children;
+        // Visit the nearer child first
+        const BvhNode left = bvh_buffer.nodes[node.first];
+        const BvhNode right = bvh_buffer.nodes[node.first + 1];
+        const bool left_first = box_distance(pos, left.bmin, left.bmax) <= box_distance(pos, right.bmin, right.bmax);
+
+        stack[stack_size++] = left_first ? node.first + 1 : node.first;
+        stack[stack_size++] = left_first ? node.first : node.first + 1;
+    }
+}
+
+// Like query_groups, but only over the groups in the workgroup's tile list, which are in group order
+void query_tile_groups(in vec3 pos, in float start_dist, in bool skip_static, out float min_dist, out uint hit_idx) {
+    min_dist = start_dist;
+    hit_idx = 0;
+
+    QUERY_RUNS(0u, tile_num_groups, tile_groups, TILE_STATIC_BIT)
+}
+
+// Only the dynamic groups are evaluated while the baked distance stays above exact_dist, it bounds the rest.
+// Tiled queries only see the groups in the tile's frustum, which is all a primary ray of the tile can hit.
+void query_scene_within(in vec3 pos, in float exact_dist, in bool tiled, out float min_dist, out uint hit_idx) {
+    float start_dist = MAX;
+    bool skip_static = false;
+    if (use_baked_field) {
+        const float baked = baked_distance(pos);
+        if (baked > exact_dist) {
+            start_dist = baked;
+            skip_static = true;
         }
     }
+
+    if (tiled) {
+        query_tile_groups(pos, start_dist, skip_static, min_dist, hit_idx);
+    } else {
+        query_groups(pos, start_dist, skip_static, min_dist, hit_idx);
+    }
+}
+
+void query_scene(in vec3 pos, in bool tiled, out float min_dist, out uint hit_idx) {
+    query_scene_within(pos, baked_refine_dist, tiled, min_dist, hit_idx);
 }
 
 float query_scene_dist(in vec3 pos) {
-    vec3 surface_color;
     float dist;
     uint hit_idx;
-    query_scene(pos, surface_color, dist, hit_idx);
+    query_scene(pos, false, dist, hit_idx);
     return dist;
 }
 
-float query_obj_dist(in vec3 pos, in uint idx) {
-    return query_object(idx, pos).w;
+// query_group with vec4(gradient, distance) registers. It runs once per hit, so specialized variants keep
+// interpreting it.
+vec4 query_group_gradient(in uint idx, in vec3 pos) {
+    const Group group = group_buffer.groups[idx];
+    vec4 regs[MAX_REGISTERS];
+
+    for (uint i = 0; i < group.num_instructions; i++) {
+        const uint inst = program_buffer.code[group.first_instruction + i];
+        const uint op = inst & 0xFu;
+        const uint dst = (inst >> 4) & 0x1Fu;
+        const uint arg = inst >> 9;
+
+        if (op == Eval) {
+            BEGIN_OBJECT_COST()
+            regs[dst] = find_gradient_to_object(object_buffer.objects[arg], pos);
+            END_OBJECT_COST(arg)
+            sdf_evals++;
+        } else {
+            regs[dst] = combine_gradient(op, regs[dst], regs[arg]);
+        }
+    }
+
+    return regs[0];
 }
 
 vec3 estimate_surface_normal(in vec3 p, uint obj_idx) {
-    float x = query_obj_dist(vec3(p.x+eps, p.y, p.z), obj_idx) - query_obj_dist(vec3(p.x-eps, p.y, p.z), obj_idx);
-    float y = query_obj_dist(vec3(p.x, p.y+eps, p.z), obj_idx) - query_obj_dist(vec3(p.x, p.y-eps, p.z), obj_idx);
-    float z = query_obj_dist(vec3(p.x, p.y, p.z+eps), obj_idx) - query_obj_dist(vec3(p.x, p.y, p.z-eps), obj_idx);
-
-    return normalize(vec3(x, y, z));
+    return normalize(query_group_gradient(obj_idx, p).xyz);
 }
 
 float compute_shadow(vec3 origin, vec3 direction, float dst_to_light) {
@@ -320,10 +896,14 @@ float compute_shadow(vec3 origin, vec3 direction, float dst_to_light) {
     float result = 1.0f;
 
     while (total_dist < dist_limit && num_steps < shadow_max_steps) {
-        vec3 surface_color;
         float dist;
         uint hit_idx;
-        query_scene(origin, surface_color, dist, hit_idx);
+
+        // Distances that can still darken the penumbra are evaluated exactly. Shadow rays leave the tile's
+        // frustum, so they see every group.
+        const float exact_dist = max(baked_refine_dist, total_dist / soft_shadow_factor);
+        query_scene_within(origin, exact_dist, false, dist, hit_idx);
+        shadow_steps++;
 
         if (dist < shadow_eps) {
             return shadow_intensity;
@@ -339,11 +919,159 @@ float compute_shadow(vec3 origin, vec3 direction, float dst_to_light) {
     return result;
 }
 
+// Moves a hit found relaxed_eps from the surface onto where the ray crosses it. The crossing is bracketed between
+// the hit and a point about as far behind the surface, rays that only graze the surface keep their hit.
+void refine_hit(in vec3 direction, in bool tiled, inout vec3 origin, inout float total_dist, inout float dist,
+                inout uint hit_idx, inout int num_steps) {
+    const int max_refine_steps = 6;
+
+    float curr_dist;
+    uint curr_idx;
+
+    float lo = 0;
+    float hi = max(dist, 0) + relaxed_eps;
+    query_scene(origin + direction * hi, tiled, curr_dist, curr_idx);
+    num_steps++;
+    if (curr_dist >= 0) return;
+
+    // Bisect until the bracket is as tight as a plain hit
+    for (int i = 0; i < max_refine_steps && hi - lo > eps; i++) {
+        const float mid = (lo + hi) * 0.5;
+        query_scene(origin + direction * mid, tiled, curr_dist, curr_idx);
+        num_steps++;
+
+        if (curr_dist < 0) {
+            hi = mid;
+            continue;
+        }
+
+        lo = mid;
+        dist = curr_dist;
+        hit_idx = curr_idx;
+    }
+
+    origin += direction * lo;
+    total_dist += lo;
+}
+
+// Sums the steps of the workgroup's invocations into the step counters
+void add_steps(in uint steps, in bool cone) {
+    if (!count_steps) return;
+
+    if (gl_LocalInvocationIndex == 0) group_steps = 0;
+    barrier();
+    atomicAdd(group_steps, steps);
+    barrier();
+
+    if (gl_LocalInvocationIndex != 0) return;
+    if (cone) {
+        atomicAdd(step_counts.cone_steps, group_steps);
+    } else {
+        atomicAdd(step_counts.march_steps, group_steps);
+    }
+}
+
+// Adds to a counter of the march statistics, carrying into its high word
+void add_march_counter(in uint counter, in uint value) {
+    const uint low = atomicAdd(march_stats.words[2u * counter], value);
+    if (low + value < low) atomicAdd(march_stats.words[2u * counter + 1u], 1u);
+}
+
+// Sums the workgroup's pixels into the march statistics, outside pixels add nothing
+void add_march_stats(in bool inside, in uint steps, in bool hit) {
+    if (!count_march_stats) return;
+
+    const uint num_stats = NUM_MARCH_COUNTERS + HISTOGRAM_BINS;
+    if (gl_LocalInvocationIndex < num_stats) group_march_stats[gl_LocalInvocationIndex] = 0u;
+    barrier();
+
+    if (inside) {
+        atomicAdd(group_march_stats[MARCH_STEPS], steps);
+        atomicAdd(group_march_stats[SHADOW_STEPS], shadow_steps);
+        atomicAdd(group_march_stats[SDF_EVALS], sdf_evals);
+        atomicAdd(group_march_stats[hit ? HITS : MISSES], 1u);
+        if (!hit && steps >= uint(max_steps)) atomicAdd(group_march_stats[EXHAUSTED], 1u);
+
+        const uint bin = min(steps / HISTOGRAM_BIN_STEPS, HISTOGRAM_BINS - 1u);
+        atomicAdd(group_march_stats[NUM_MARCH_COUNTERS + bin], 1u);
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex < num_stats && group_march_stats[gl_LocalInvocationIndex] != 0u) {
+        add_march_counter(gl_LocalInvocationIndex, group_march_stats[gl_LocalInvocationIndex]);
+    }
+}
+
+// Marches a cone around the rays of one block of pixels, as far as no surface can touch any of them, and stores
+// the depth they can all start from
+void march_cone() {
+    const ivec2 cell = ivec2(gl_GlobalInvocationID.xy);
+    const bool inside = all(lessThan(cell, imageSize(cone_depth)));
+
+    const vec2 image_size = vec2(image_width, image_height);
+    const vec2 lo = vec2(cell) * float(cone_cell_size);
+    const vec2 hi = lo + float(cone_cell_size);
+    const vec3 direction = get_ray_direction((lo + hi) / image_size - 1);
+
+    // Ray directions are unit length, so at distance t the cone's rays are within t * spread of the center ray
+    float spread = 0;
+    spread = max(spread, length(get_ray_direction(lo / image_size * 2 - 1) - direction));
+    spread = max(spread, length(get_ray_direction(vec2(hi.x, lo.y) / image_size * 2 - 1) - direction));
+    spread = max(spread, length(get_ray_direction(hi / image_size * 2 - 1) - direction));
+    spread = max(spread, length(get_ray_direction(vec2(lo.x, hi.y) / image_size * 2 - 1) - direction));
+
+    const vec3 origin = get_ray_origin();
+    int num_steps = 0;
+    float total_dist = 0;
+
+    while (inside && total_dist < max_dist && num_steps < max_steps) {
+        // Everything within dist of the center ray's point is empty. A step s reaches cone points up to
+        // s + spread * (total_dist + s) away, the radius at its far end included, so s is kept within that.
+        const float dist = query_scene_dist(origin + direction * total_dist);
+        const float step = (dist - spread * total_dist) / (1 + spread);
+        if (step < eps) break;
+
+        total_dist += step;
+        num_steps++;
+    }
+
+    if (inside) imageStore(cone_depth, cell, vec4(total_dist));
+    add_steps(uint(num_steps), true);
+}
 
 void main() {
+    // Stage the objects' shapes, types are small enough to be exact as floats
+    for (uint i = gl_LocalInvocationIndex; i < num_staged_objects; i += gl_WorkGroupSize.x * gl_WorkGroupSize.y) {
+        const Object o = object_buffer.objects[i];
+        staged_shapes[2 * i] = vec4(o.x, o.y, o.z, float(o.type));
+        staged_shapes[2 * i + 1] = vec4(o.sx, o.sy, o.sz, 0);
+    }
+    barrier();
+
+    if (cone_pass) {
+        march_cone();
+        return;
+    }
+
     const ivec2 pixel_coords = ivec2(gl_GlobalInvocationID.xy);
     vec4 out_pixel = vec4(0.0, 0.0, 0.0, 1.0);
 
+    // Stage the tile's group list. Tiles whose list overflowed march against the whole scene.
+    bool tiled = false;
+    if (use_tile_lists) {
+        const uint tile = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+        const uint count = tile_count_buffer.counts[tile];
+        tiled = count <= MAX_TILE_GROUPS;
+
+        if (tiled) {
+            if (gl_LocalInvocationIndex == 0) tile_num_groups = count;
+            for (uint i = gl_LocalInvocationIndex; i < count; i += gl_WorkGroupSize.x * gl_WorkGroupSize.y) {
+                tile_groups[i] = tile_list_buffer.entries[tile * MAX_TILE_GROUPS + i];
+            }
+        }
+        barrier();
+    }
+
     // Get current UV coordinates
     const vec2 uv = vec2(gl_GlobalInvocationID.xy) / vec2(image_width, image_height) * 2 - 1;
 
@@ -351,21 +1079,47 @@ void main() {
     vec3 origin = get_ray_origin();
     const vec3 direction = get_ray_direction(uv);
 
-    // Raymarching
+    // Raymarching, past the empty space the cone pre-pass found
     int num_steps = 0;
-    float total_dist = 0;
+    float total_dist = use_cone_depth ? imageLoad(cone_depth, pixel_coords / int(cone_cell_size)).r : 0;
     bool hit_obj = false;
+    uint hit_group = 0u;
+    origin += direction * total_dist;
+
+    // Relaxed steps are stretched by omega until one fails
+    float omega = relaxation;
+    const float hit_eps = relaxation > 1 ? relaxed_eps : eps;
+    float prev_dist = 0;
+    float step = 0;
 
     while (total_dist < max_dist && num_steps < max_steps) {
-        vec3 surface_color;
         float dist;
         uint hit_idx;
-        query_scene(origin, surface_color, dist, hit_idx);
+        query_scene(origin, tiled, dist, hit_idx);
+
+        // A relaxed step is safe while the unbounding spheres of this point and the last one overlap. Otherwise it
+        // may have skipped a surface, so the ray backs off to where a plain step would have landed and stops
+        // relaxing.
+        if (omega > 1 && abs(dist) + prev_dist < step) {
+            origin -= direction * (step - prev_dist);
+            total_dist -= step - prev_dist;
+            omega = 1;
+            num_steps++;
+            continue;
+        }
 
         // Hit object
-        if (dist < eps) {
+        if (dist < hit_eps) {
+            if (relaxation > 1) {
+                refine_hit(direction, tiled, origin, total_dist, dist, hit_idx, num_steps);
+            }
+
             hit_obj = true;
-            Object curr = object_buffer.objects[hit_idx];
+            hit_group = hit_idx;
+            Object curr = object_buffer.objects[group_buffer.groups[hit_idx].material_object];
+
+            // The march only carried distances, the color is resolved once here
+            const vec3 surface_color = query_group(hit_idx, origin).rgb;
 
             vec3 hit_point = origin + dist * direction;
             vec3 surface_normal = estimate_surface_normal(hit_point - eps * direction, hit_idx);
@@ -398,8 +1152,10 @@ void main() {
             break;
         }
 
-        origin = origin + direction * dist;
-        total_dist += dist;
+        prev_dist = dist;
+        step = dist * omega;
+        origin = origin + direction * step;
+        total_dist += step;
         num_steps++;
     }
 
@@ -414,5 +1170,13 @@ void main() {
         out_pixel = vec4(val, val, val, 1.0f);
     }
 
-    imageStore(img_output, pixel_coords, out_pixel);
+#ifdef PROFILE_OBJECTS
+    if (show_cost_heat) out_pixel = vec4(hit_obj ? heat_color(group_heat.heat[hit_group]) : vec3(0.05), 1.0);
+#endif
+
+    // Invocations past the image write nothing, at reduced resolution they would land inside the texture
+    const bool inside = all(lessThan(pixel_coords, ivec2(image_width, image_height)));
+    if (inside) imageStore(img_output, pixel_coords, out_pixel);
+    add_steps(inside ? uint(num_steps) : 0u, false);
+    add_march_stats(inside, uint(num_steps), hit_obj);
 }
\ No newline at end of file
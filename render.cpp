@@ -0,0 +1,167 @@
+#include <cpu/raymarcher.h>
+#include <cpu/thread_pool.h>
+#include <engine/scene.h>
+#include <utils/buf.h>
+#include <utils/image.h>
+
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+// Headless batch renderer. Loads a scene file and renders it on the CPU without creating a window or a GL context.
+
+struct RenderOptions {
+    std::filesystem::path scene_path = "test.scene";
+    std::filesystem::path output_path = "render.png";
+
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t threads = std::thread::hardware_concurrency();
+
+    std::optional<glm::vec3> camera_pos;
+    std::optional<float> yaw;
+    std::optional<float> pitch;
+    std::optional<float> fov;
+};
+
+void print_usage() {
+    std::cout << "Usage: raymarch-render [scene] [options]\n"
+                 "  -o, --output <path>     Output image (.png, .pfm or .exr). Default render.png\n"
+                 "  -w, --width <px>        Image width. Default 1280\n"
+                 "  -h, --height <px>       Image height. Default 720\n"
+                 "  -t, --threads <n>       Worker threads. Default is one per core\n"
+                 "  --camera-pos <x,y,z>    Camera position\n"
+                 "  --yaw <deg>             Camera yaw\n"
+                 "  --pitch <deg>           Camera pitch\n"
+                 "  --fov <deg>             Vertical field of view, overrides the scene's" << std::endl;
+}
+
+template<typename T>
+Err parse_number(const std::string_view &str, T &ret) {
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), ret);
+    if (ec != std::errc() || end != str.data() + str.size()) return Err("Invalid number \"{}\".", str);
+    return {};
+}
+
+Err parse_vec3(const std::string_view &str, glm::vec3 &ret) {
+    size_t start = 0;
+    for (int i = 0; i < 3; ++i) {
+        const size_t end = i < 2 ? str.find(',', start) : str.size();
+        if (end == std::string_view::npos) return Err("Expected x,y,z but got \"{}\".", str);
+
+        if (Err err = parse_number(str.substr(start, end - start), ret[i])) return err;
+        start = end + 1;
+    }
+    return {};
+}
+
+Err parse_args(const int argc, char **argv, RenderOptions &options) {
+    bool scene_set = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+
+        // All options take exactly one value
+        if (arg.starts_with("-")) {
+            if (i + 1 >= argc) return Err("Missing value for {}.", arg);
+            const std::string_view value = argv[++i];
+
+            Err err;
+            if (arg == "-o" || arg == "--output") options.output_path = value;
+            else if (arg == "-w" || arg == "--width") err = parse_number(value, options.width);
+            else if (arg == "-h" || arg == "--height") err = parse_number(value, options.height);
+            else if (arg == "-t" || arg == "--threads") err = parse_number(value, options.threads);
+            else if (arg == "--camera-pos") err = parse_vec3(value, options.camera_pos.emplace());
+            else if (arg == "--yaw") err = parse_number(value, options.yaw.emplace());
+            else if (arg == "--pitch") err = parse_number(value, options.pitch.emplace());
+            else if (arg == "--fov") err = parse_number(value, options.fov.emplace());
+            else return Err("Unknown option {}.", arg);
+
+            if (err) return err.add("Failed to parse {}.", arg);
+            continue;
+        }
+
+        if (scene_set) return Err("Unexpected argument {}.", arg);
+        options.scene_path = arg;
+        scene_set = true;
+    }
+
+    if (options.width == 0 || options.height == 0) return Err("Image size must be non-zero.");
+    return {};
+}
+
+int main(int argc, char **argv) {
+    using clock = std::chrono::steady_clock;
+
+    RenderOptions options;
+    Err err;
+    if (argc > 1 && (std::string_view(argv[1]) == "--help")) {
+        print_usage();
+        return 0;
+    }
+
+    if ((err = parse_args(argc, argv, options))) {
+        err.print();
+        print_usage();
+        return 1;
+    }
+
+    const auto time_ms = [](const clock::time_point start, const clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    // Load scene
+    const clock::time_point load_start = clock::now();
+
+    Scene scene;
+    Buffer buffer;
+    if ((err = buffer.read_from_file(options.scene_path)) || (err = scene.read_from_buffer(buffer))) {
+        err.add("Failed to load scene {}.", options.scene_path.string()).print();
+        return 1;
+    }
+
+    if (options.camera_pos) scene.camera.pos = *options.camera_pos;
+    if (options.yaw || options.pitch) {
+        scene.camera.set_rotation(options.yaw.value_or(scene.camera.yaw),
+                                  options.pitch.value_or(scene.camera.pitch));
+    }
+    if (options.fov) scene.fov = *options.fov;
+
+    // Thread startup is counted separately, it is paid once per process
+    const clock::time_point setup_start = clock::now();
+    cpu::ThreadPool pool(options.threads);
+    const cpu::Raymarcher raymarcher(pool);
+    Image image(options.width, options.height);
+
+    // Render
+    const clock::time_point render_start = clock::now();
+    if ((err = raymarcher.render(scene, image))) {
+        err.print();
+        return 1;
+    }
+
+    // Write output
+    const clock::time_point write_start = clock::now();
+    if ((err = image.write_to_file(options.output_path))) {
+        err.print();
+        return 1;
+    }
+    const clock::time_point write_end = clock::now();
+
+    std::cout << std::format("Rendered {} at {}x{} on {} threads to {}\n"
+                             "  load:   {:8.2f} ms\n"
+                             "  setup:  {:8.2f} ms\n"
+                             "  render: {:8.2f} ms\n"
+                             "  write:  {:8.2f} ms\n"
+                             "  total:  {:8.2f} ms",
+                             options.scene_path.string(), options.width, options.height, pool.size(),
+                             options.output_path.string(),
+                             time_ms(load_start, setup_start), time_ms(setup_start, render_start),
+                             time_ms(render_start, write_start), time_ms(write_start, write_end),
+                             time_ms(load_start, write_end))
+              << std::endl;
+
+    return 0;
+}
@@ -1,26 +1,90 @@
 #include <compute/compute.h>
+#include <compute/program_cache.h>
+#include <utils/trace.h>
 
 #include <array>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <chrono>
 #include <fstream>
 
 namespace compute {
-    Err ComputeShader::init(const std::filesystem::path &shader_path) {
+    std::expected<std::string, Err> read_shader_source(const std::filesystem::path &shader_path) {
         std::ifstream file;
         file.open(shader_path);
 
-        if (!file.is_open() || file.fail()) return Err("Failed to open shader file: {}", shader_path.string());
+        if (!file.is_open() || file.fail()) {
+            return std::unexpected(Err("Failed to open shader file: {}", shader_path.string()));
+        }
 
         std::stringstream str_stream;
         str_stream << file.rdbuf();
 
-        if (file.fail()) return Err("Failed to read shader file: {}", shader_path.string());
+        if (file.fail()) return std::unexpected(Err("Failed to read shader file: {}", shader_path.string()));
 
-        return init(str_stream.str());
+        return str_stream.str();
+    }
+
+    Err ComputeShader::init(const std::filesystem::path &shader_path) {
+        const std::expected<std::string, Err> code = read_shader_source(shader_path);
+        if (!code) return code.error();
+
+        return init(*code);
+    }
+
+    namespace {
+        // GL_KHR_parallel_shader_compile, not part of the loader
+        constexpr GLenum COMPLETION_STATUS_KHR = 0x91B1;
+
+        // Checking the current program is a state query, which stalls on some drivers, so only debug builds check it
+#ifdef NDEBUG
+        constexpr bool check_active = false;
+#else
+        constexpr bool check_active = true;
+#endif
+
+        bool has_parallel_shader_compile() {
+            static const bool supported = [] {
+                GLint num_extensions = 0;
+                glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+
+                for (GLint i = 0; i < num_extensions; i++) {
+                    const auto *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+                    if (name && std::string_view(name) == "GL_KHR_parallel_shader_compile") return true;
+                }
+                return false;
+            }();
+
+            return supported;
+        }
     }
 
     Err ComputeShader::init(const std::string &code) {
+        TRACE_ZONE("ComputeShader::init");
+        const auto start = std::chrono::steady_clock::now();
+
+        Err err;
+        if ((err = init_async(code))) return err;
+
+        // Loaded from the program cache
+        if (!shader_id) return {};
+
+        if ((err = finish())) return err;
+
+        record_program_compile(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        return {};
+    }
+
+    Err ComputeShader::init_async(const std::string &code) {
+        program_id = glCreateProgram();
+        if (!program_id) return Err("Failed to create compute shader program.");
+
+        if (load_program_binary(program_id, code)) {
+            cache_uniform_locations();
+            return {};
+        }
+
         // Create shader and link source code
         shader_id = glCreateShader(GL_COMPUTE_SHADER);
         if (!shader_id) return Err("Failed to create compute shader.");
@@ -31,6 +95,43 @@ namespace compute {
         // Compile compute shader
         glCompileShader(shader_id);
 
+        // Link shader into the program
+        glAttachShader(program_id, shader_id);
+        glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program_id);
+
+        uncached_source = code;
+        return {};
+    }
+
+    std::expected<bool, Err> ComputeShader::poll() {
+        // Linked straight from a cached binary
+        if (!shader_id) return true;
+
+        if (has_parallel_shader_compile()) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(program_id, COMPLETION_STATUS_KHR, &complete);
+            if (!complete) return false;
+        }
+
+        if (Err err = finish()) return std::unexpected(err);
+        return true;
+    }
+
+    Err ComputeShader::finish() {
+        Err err;
+        if ((err = check_status())) return err;
+        cache_uniform_locations();
+
+        if (!uncached_source.empty()) {
+            if ((err = store_program_binary(program_id, uncached_source))) err.print();
+            uncached_source.clear();
+        }
+
+        return {};
+    }
+
+    Err ComputeShader::check_status() const {
         GLint success;
         std::array<char, 1024> error_info{};
         glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
@@ -40,13 +141,6 @@ namespace compute {
             return Err("Error compiling shader source code. \n{}", error_info.data());
         }
 
-        // Create program and link shader
-        program_id = glCreateProgram();
-        if (!program_id) return Err("Failed to create compute shader program.");
-
-        glAttachShader(program_id, shader_id);
-        glLinkProgram(program_id);
-
         glGetProgramiv(program_id, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(program_id, error_info.size(), nullptr, error_info.data());
@@ -56,16 +150,57 @@ namespace compute {
         return {};
     }
 
+    void ComputeShader::cache_uniform_locations() {
+        uniform_locations.clear();
+
+        GLint num_uniforms = 0;
+        GLint max_length = 0;
+        glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &num_uniforms);
+        glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+        std::string name(max_length, '\0');
+        for (GLint i = 0; i < num_uniforms; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program_id, i, max_length, &length, &size, &type, name.data());
+
+            const GLint location = glGetUniformLocation(program_id, name.c_str());
+            if (location >= 0) uniform_locations.emplace(name.substr(0, length), location);
+        }
+    }
+
+    GLint ComputeShader::uniform_location(const std::string_view id) const {
+        const auto it = uniform_locations.find(id);
+        return it == uniform_locations.end() ? -1 : it->second;
+    }
+
+    void ComputeShader::destroy() {
+        if (program_id) glDeleteProgram(program_id);
+        if (shader_id) glDeleteShader(shader_id);
+        program_id = 0;
+        shader_id = 0;
+        uncached_source.clear();
+        uniform_locations.clear();
+    }
+
     Err ComputeShader::bind_buffer(const ComputeBuffer &buf, GLuint index) const {
-        if (!is_active()) return Err("Attempting to attach buffer to inactive program.");
+        if (check_active && !is_active()) return Err("Attempting to attach buffer to inactive program.");
 
         buf.bind();
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buf.id());
         return {};
     }
 
+    Err ComputeShader::bind_buffer(const MappedBuffer &buf, GLuint index) const {
+        if (check_active && !is_active()) return Err("Attempting to attach buffer to inactive program.");
+
+        buf.bind(index);
+        return {};
+    }
+
     Err ComputeShader::execute(GLuint nx, GLuint ny, GLuint nz) const {
-        if (!is_active()) return Err("Attempting execute inactive program.");
+        if (check_active && !is_active()) return Err("Attempting execute inactive program.");
 
         glDispatchCompute(nx, ny, nz);
         return {};
@@ -83,42 +218,49 @@ namespace compute {
     }
 
     Err ComputeShader::bind(const std::string_view &id, const GLint value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniform1i(attr_id, value);
         return {};
     }
 
     Err ComputeShader::bind(const std::string_view &id, const GLuint value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniform1ui(attr_id, value);
         return {};
     }
 
     Err ComputeShader::bind(const std::string_view &id, const GLfloat value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniform1f(attr_id, value);
         return {};
     }
 
     Err ComputeShader::bind(const std::string_view &id, const GLboolean value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniform1i(attr_id, value);
         return {};
     }
 
     Err ComputeShader::bind(const std::string_view &id, const glm::vec3 &value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniform3f(attr_id, value[0], value[1], value[2]);
         return {};
     }
 
+    Err ComputeShader::bind(const std::string_view &id, const glm::uvec3 &value) const {
+        const GLint attr_id = uniform_location(id);
+        if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
+        glUniform3ui(attr_id, value[0], value[1], value[2]);
+        return {};
+    }
+
     Err ComputeShader::bind(const std::string_view &id, const glm::mat4x4 &value) const {
-        const GLint attr_id = glGetUniformLocation(program_id, id.data());
+        const GLint attr_id = uniform_location(id);
         if (attr_id < 0) return Err("Failed to bind uniform {}. Cannot find uniform location.", id);
         glUniformMatrix4fv(attr_id, 1, GL_FALSE, glm::value_ptr(value));
         return {};
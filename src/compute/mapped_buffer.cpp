@@ -0,0 +1,109 @@
+#include <compute/mapped_buffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace compute {
+    namespace {
+        constexpr size_t min_region_capacity = 1024;
+        constexpr GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    }
+
+    MappedBuffer::MappedBuffer(const size_t record_size, const GLenum target) : record_size(record_size),
+                                                                               target(target) {
+
+    }
+
+    Err MappedBuffer::init() {
+        GLint alignment = 1;
+        glGetIntegerv(target == GL_UNIFORM_BUFFER ? GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+                                                  : GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        offset_alignment = static_cast<size_t>(std::max(alignment, 1));
+
+        return allocate(min_region_capacity);
+    }
+
+    Err MappedBuffer::allocate(const size_t size) {
+        for (GLsync &fence: fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        // The old storage is only freed once the GPU is done with it
+        if (buffer_id) {
+            glUnmapNamedBuffer(buffer_id);
+            glDeleteBuffers(1, &buffer_id);
+        }
+
+        region_capacity = ceil_divide(std::max(size, min_region_capacity), offset_alignment) * offset_alignment;
+        glCreateBuffers(1, &buffer_id);
+        glNamedBufferStorage(buffer_id, static_cast<GLsizeiptr>(NUM_REGIONS * region_capacity), nullptr, map_flags);
+        mapped = static_cast<uint8_t *>(glMapNamedBufferRange(buffer_id, 0,
+                                                              static_cast<GLsizeiptr>(NUM_REGIONS * region_capacity),
+                                                              map_flags));
+
+        for (std::vector<uint8_t> &region_contents: contents) region_contents.clear();
+        region = 0;
+
+        if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR || !mapped) {
+            return Err("Failed to map a {} byte buffer. GL error {}.", NUM_REGIONS * region_capacity, gl_err);
+        }
+        return {};
+    }
+
+    Err MappedBuffer::update(const void *data, const size_t size) {
+        last_upload = 0;
+
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        const std::vector<uint8_t> &bound = contents[region];
+        if (bound.size() == size && (size == 0 || memcmp(bound.data(), bytes, size) == 0)) return {};
+
+        Err err;
+        if (size > region_capacity && (err = allocate(std::max(size, 2 * region_capacity)))) return err;
+
+        const size_t next = (region + 1) % NUM_REGIONS;
+        if (fences[next]) {
+            // Last read NUM_REGIONS - 1 changes ago, so this rarely has to wait
+            glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[next]);
+            fences[next] = nullptr;
+        }
+
+        // Copies the runs of records that differ from what the region holds
+        std::vector<uint8_t> &old = contents[next];
+        uint8_t *const dst = mapped + next * region_capacity;
+        const size_t common = std::min(old.size(), size);
+
+        size_t run_begin = 0;
+        bool in_run = false;
+        for (size_t offset = 0; offset < size; offset += record_size) {
+            const size_t count = std::min(record_size, size - offset);
+            const bool differs = offset + count > common || memcmp(old.data() + offset, bytes + offset, count) != 0;
+
+            if (differs && !in_run) run_begin = offset;
+            if (!differs && in_run) {
+                memcpy(dst + run_begin, bytes + run_begin, offset - run_begin);
+                last_upload += offset - run_begin;
+            }
+            in_run = differs;
+        }
+        if (in_run) {
+            memcpy(dst + run_begin, bytes + run_begin, size - run_begin);
+            last_upload += size - run_begin;
+        }
+
+        old.assign(bytes, bytes + size);
+        region = next;
+        return {};
+    }
+
+    void MappedBuffer::end_frame() {
+        if (fences[region]) glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void MappedBuffer::bind(const GLuint index) const {
+        glBindBufferRange(target, index, buffer_id, static_cast<GLintptr>(region * region_capacity),
+                          static_cast<GLsizeiptr>(region_capacity));
+    }
+}
@@ -0,0 +1,172 @@
+#include <compute/program_cache.h>
+#include <utils/buf.h>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <vector>
+
+namespace compute {
+    namespace {
+        constexpr uint32_t cache_magic = 0x42504D52; // "RMPB"
+
+        std::filesystem::path cache_dir = "shader_cache";
+        ProgramCacheStats stats;
+
+        // FNV-1a
+        uint64_t hash_bytes(uint64_t hash, const std::string_view bytes) {
+            for (const char c: bytes) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        std::string_view gl_string(const GLenum name) {
+            const auto *str = reinterpret_cast<const char *>(glGetString(name));
+            return str ? std::string_view(str) : std::string_view();
+        }
+
+        uint64_t cache_key(const std::string_view sources) {
+            // A NUL between the fields keeps "ab" + "c" from hashing like "a" + "bc"
+            static const uint64_t driver_hash = [] {
+                uint64_t hash = 14695981039346656037ull;
+                for (const GLenum name: {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+                    hash = hash_bytes(hash, gl_string(name));
+                    hash = hash_bytes(hash, std::string_view("\0", 1));
+                }
+                return hash;
+            }();
+
+            return hash_bytes(driver_hash, sources);
+        }
+
+        bool cache_enabled() {
+            if (cache_dir.empty()) return false;
+
+            static const bool supported = [] {
+                GLint num_formats = 0;
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+                return num_formats > 0;
+            }();
+
+            return supported;
+        }
+
+        std::filesystem::path entry_path(const uint64_t key) {
+            return cache_dir / std::format("{:016x}.bin", key);
+        }
+
+        // Deletes the least recently used entries until at most MAX_PROGRAM_CACHE_ENTRIES are left
+        void prune_cache() {
+            std::error_code ec;
+            std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+            for (const std::filesystem::directory_entry &entry: std::filesystem::directory_iterator(cache_dir, ec)) {
+                if (entry.path().extension() != ".bin") continue;
+
+                const std::filesystem::file_time_type time = entry.last_write_time(ec);
+                if (!ec) entries.emplace_back(time, entry.path());
+            }
+            if (entries.size() <= MAX_PROGRAM_CACHE_ENTRIES) return;
+
+            std::ranges::sort(entries, {}, [](const auto &entry) { return entry.first; });
+            for (size_t i = 0; i < entries.size() - MAX_PROGRAM_CACHE_ENTRIES; i++) {
+                std::filesystem::remove(entries[i].second, ec);
+            }
+        }
+
+        double elapsed_ms(const std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    void set_program_cache_dir(const std::filesystem::path &dir) {
+        cache_dir = dir;
+    }
+
+    bool load_program_binary(const GLuint program, const std::string_view sources) {
+        if (!cache_enabled()) return false;
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t key = cache_key(sources);
+        const std::filesystem::path path = entry_path(key);
+
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) {
+            stats.misses++;
+            return false;
+        }
+
+        // Header: magic, binary format and the full key, followed by the binary itself
+        Buffer buffer;
+        uint32_t magic = 0;
+        GLenum format = 0;
+        uint64_t stored_key = 0;
+
+        bool loaded = !buffer.read_from_file(path) && !buffer.read(magic, format, stored_key) &&
+                      magic == cache_magic && stored_key == key;
+
+        if (loaded) {
+            const size_t binary_size = buffer.remaining();
+            const uint8_t *binary = buffer.get_data() + (buffer.size() - binary_size);
+            glProgramBinary(program, format, binary, static_cast<GLsizei>(binary_size));
+
+            GLint success = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            loaded = success == GL_TRUE;
+        }
+
+        if (!loaded) {
+            std::filesystem::remove(path, ec);
+            stats.rejected++;
+            stats.misses++;
+            return false;
+        }
+
+        // The modification time orders the entries for pruning
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+        stats.hits++;
+        stats.load_ms += elapsed_ms(start);
+        return true;
+    }
+
+    Err store_program_binary(const GLuint program, const std::string_view sources) {
+        if (!cache_enabled()) return {};
+
+        GLint binary_size = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+        if (binary_size <= 0) return {};
+
+        std::vector<uint8_t> binary(binary_size);
+        GLenum format = 0;
+        glGetProgramBinary(program, binary_size, nullptr, &format, binary.data());
+
+        const uint64_t key = cache_key(sources);
+        Buffer buffer(binary.size() + 16);
+        Err err;
+        if ((err = buffer.write(cache_magic, format, key)) ||
+            (err = buffer.write_bytes(binary.data(), binary.size()))) {
+            return err.add("Failed to cache program binary.");
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(cache_dir, ec);
+        if (ec) return Err("Failed to create shader cache directory {}.", cache_dir.string());
+
+        if ((err = buffer.write_to_file(entry_path(key)))) {
+            return err.add("Failed to cache program binary.");
+        }
+
+        prune_cache();
+        return {};
+    }
+
+    void record_program_compile(const double ms) {
+        stats.compile_ms += ms;
+    }
+
+    const ProgramCacheStats &program_cache_stats() {
+        return stats;
+    }
+}
@@ -0,0 +1,49 @@
+#include <compute/readback.h>
+
+namespace compute {
+    void GpuFence::signal() {
+        if (sync) glDeleteSync(sync);
+        sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    bool GpuFence::poll() {
+        if (!sync || glClientWaitSync(sync, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+
+        glDeleteSync(sync);
+        sync = nullptr;
+        return true;
+    }
+
+    Err GpuTimer::init() {
+        glGenQueries(static_cast<GLsizei>(query_ids.size()), query_ids.data());
+
+        if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+            return Err("Failed to create GPU timer queries. GL error {}.", gl_err);
+        }
+        return {};
+    }
+
+    void GpuTimer::begin() {
+        glQueryCounter(query_ids[0], GL_TIMESTAMP);
+    }
+
+    void GpuTimer::end() {
+        glQueryCounter(query_ids[1], GL_TIMESTAMP);
+        pending = true;
+    }
+
+    std::optional<float> GpuTimer::poll_ms() {
+        if (!pending) return std::nullopt;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query_ids[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return std::nullopt;
+        pending = false;
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(query_ids[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query_ids[1], GL_QUERY_RESULT, &end);
+        return static_cast<float>(end - begin) / 1e6f;
+    }
+}
@@ -0,0 +1,69 @@
+#include <cpu/program_eval.h>
+#include <cpu/sdf.h>
+#include <cpu/sdf_simd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace cpu {
+    void combine_distances(const SdfOp op, float *curr, const float *other, const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            curr[i] = combine_distance(op, curr[i], other[i]);
+        }
+    }
+
+    float evaluate_group(const SdfProgram &program, const SdfGroup &group, const glm::vec3 &pos) {
+        std::array<float, SDF_MAX_REGISTERS> regs;
+
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+
+            if (inst.op == SdfOp::Eval) {
+                regs[inst.dst] = find_distance_to_object(program.objects[inst.arg], pos);
+            } else {
+                combine_distances(inst.op, &regs[inst.dst], &regs[inst.arg], 1);
+            }
+        }
+
+        return regs[0];
+    }
+
+    Dual evaluate_group_gradient(const SdfProgram &program, const SdfGroup &group, const glm::vec3 &pos) {
+        std::array<Dual, SDF_MAX_REGISTERS> regs;
+
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+
+            if (inst.op == SdfOp::Eval) {
+                regs[inst.dst] = find_gradient_to_object(program.objects[inst.arg], pos);
+            } else {
+                regs[inst.dst] = combine_distance(inst.op, regs[inst.dst], regs[inst.arg]);
+            }
+        }
+
+        return regs[0];
+    }
+
+    void evaluate_group(const SdfProgram &program, const SdfGroup &group, const float *x, const float *y,
+                        const float *z, float *out, const size_t count) {
+        std::array<std::array<float, MAX_GROUP_BATCH>, SDF_MAX_REGISTERS> regs;
+
+        for (size_t start = 0; start < count; start += MAX_GROUP_BATCH) {
+            const size_t n = std::min(count - start, MAX_GROUP_BATCH);
+
+            for (uint32_t i = 0; i < group.num_instructions; i++) {
+                const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+
+                if (inst.op == SdfOp::Eval) {
+                    evaluate_batch(program.objects[inst.arg], x + start, y + start, z + start,
+                                   regs[inst.dst].data(), n);
+                } else {
+                    combine_distances(inst.op, regs[inst.dst].data(), regs[inst.arg].data(), n);
+                }
+            }
+
+            std::copy_n(regs[0].data(), n, out + start);
+        }
+    }
+}
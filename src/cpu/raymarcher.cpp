@@ -0,0 +1,588 @@
+#include <cpu/raymarcher.h>
+#include <cpu/program_eval.h>
+#include <cpu/sdf.h>
+#include <utils/algo.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace cpu {
+    namespace {
+        // Must match the constants in raymarching_shader.glsl
+        constexpr float max_dist = 100.0f;
+        constexpr float eps = 0.01f;
+        constexpr float max_steps = 128;
+
+        constexpr float shadow_eps = 0.01f;
+        constexpr float shadow_max_steps = 64;
+        constexpr float shadow_max_dist = 50.0f;
+        constexpr float soft_shadow_factor = 32;
+
+        constexpr float gamma = 2.2f;
+
+        // A packet keeps its shared step while the closest ray is at least this fraction of the farthest
+        constexpr float packet_divergence_ratio = 0.5f;
+        constexpr size_t max_packet_rays = Raymarcher::PACKET_SIZE * Raymarcher::PACKET_SIZE;
+
+        struct FrameData {
+            const Scene &scene;
+            SdfProgram program;
+            SceneBvh bvh;
+
+            // Stands in for the static groups when set
+            const BakedField *baked;
+
+            glm::mat4 view;
+            glm::mat4 inv_proj;
+            glm::vec3 origin;
+            uint32_t width;
+            uint32_t height;
+        };
+
+        // Marching steps of the tile the current thread works on
+        thread_local uint64_t tile_steps = 0;
+
+        // Where a ray resumes marching, so packets can hand their rays over mid-march
+        struct RayState {
+            glm::vec3 origin;
+            float total_dist;
+            int num_steps;
+        };
+
+        // GLSL mod() semantics, which differ from std::fmod for negative values
+        inline float glsl_mod(const float x, const float y) {
+            return x - y * std::floor(x / y);
+        }
+
+        glm::vec3 get_object_color(const ObjectRecord &obj, const glm::vec3 &pos) {
+            if (obj.type == ObjectType::GridPlane) {
+                const bool x = glsl_mod(static_cast<float>(static_cast<int>(pos.x)),
+                                        static_cast<float>(static_cast<int>(obj.scale.x * 2))) < obj.scale.x;
+                const bool z = glsl_mod(static_cast<float>(static_cast<int>(pos.z)),
+                                        static_cast<float>(static_cast<int>(obj.scale.z * 2))) < obj.scale.z;
+
+                if (x) {
+                    return z ? glm::vec3(1) : glm::vec3(0.5);
+                }
+
+                return z ? glm::vec3(0.5) : glm::vec3(1.0);
+            }
+
+            return obj.color;
+        }
+
+        // combination functions
+        glm::vec4 smooth_min(const glm::vec4 &a, const glm::vec4 &b, const float k) {
+            const float h = std::max(k - std::abs(a.w - b.w), 0.0f) / k;
+            const float m = h * h * 0.5f;
+            const float s = m * k * (1.0f / 2.0f);
+
+            const glm::vec2 mix = (a.w < b.w) ? glm::vec2(a.w - s, m) : glm::vec2(b.w - s, 1.0f - m);
+
+            return (1 - mix.y) * a + mix.y * b;
+        }
+
+        glm::vec4 subtraction(const glm::vec4 &a, const glm::vec4 &b) {
+            return {glm::vec3(a), std::max(-b.w, a.w)};
+        }
+
+        glm::vec4 intersection(const glm::vec4 &a, const glm::vec4 &b) {
+            return {glm::vec3(a), std::max(a.w, b.w)};
+        }
+
+        glm::vec4 combine(const SdfOp op, const glm::vec4 &curr_data, const glm::vec4 &other_data) {
+            switch (op) {
+                case SdfOp::Union:
+                    return curr_data.w < other_data.w ? curr_data : other_data;
+                case SdfOp::SmoothUnion:
+                    return smooth_min(curr_data, other_data, 10);
+                case SdfOp::Subtract:
+                    return subtraction(curr_data, other_data);
+                case SdfOp::Intersect:
+                    return intersection(curr_data, other_data);
+                default:
+                    return curr_data;
+            }
+        }
+
+        // Interprets a group's instructions, returning its color and distance. Marching only needs distances, see
+        // evaluate_group, so this runs once per hit to resolve the color.
+        glm::vec4 query_group(const FrameData &frame, const size_t idx, const glm::vec3 &pos) {
+            const SdfGroup &group = frame.program.groups[idx];
+            std::array<glm::vec4, SDF_MAX_REGISTERS> regs;
+
+            for (uint32_t i = 0; i < group.num_instructions; i++) {
+                const SdfInstruction inst = SdfInstruction::decode(frame.program.code[group.first_instruction + i]);
+
+                if (inst.op == SdfOp::Eval) {
+                    const ObjectRecord &curr = frame.program.objects[inst.arg];
+                    regs[inst.dst] = glm::vec4(get_object_color(curr, pos), find_distance_to_object(curr, pos));
+                } else {
+                    regs[inst.dst] = combine(inst.op, regs[inst.dst], regs[inst.arg]);
+                }
+            }
+
+            return regs[0];
+        }
+
+        float box_distance(const BvhNode &node, const glm::vec3 &pos) {
+            return glm::length(glm::max(glm::max(node.min - pos, pos - node.max), 0.0f));
+        }
+
+        // Closest group to pos that beats start_dist. With skip_static the static groups are left out, the
+        // baked field stands in for them.
+        void query_groups(const FrameData &frame, const glm::vec3 &pos, const float start_dist, const bool skip_static,
+                          float &min_dist, size_t &hit_idx) {
+            min_dist = start_dist;
+            hit_idx = 0;
+
+            const auto query_item = [&](const uint32_t item) {
+                const uint32_t idx = frame.bvh.items[item];
+                const float dist = evaluate_group(frame.program, frame.program.groups[idx], pos);
+
+                if (dist < min_dist) {
+                    min_dist = dist;
+                    hit_idx = idx;
+                }
+            };
+
+            // Unbounded groups first, they usually give a tight distance to cull the tree with
+            for (uint32_t i = 0; i < frame.bvh.num_unbounded; i++) query_item(i);
+
+            if (frame.bvh.nodes.empty()) return;
+
+            // Skip subtrees whose bounds are farther away than the closest group so far
+            std::array<uint32_t, SceneBvh::MAX_DEPTH> stack;
+            uint32_t stack_size = 1;
+            stack[0] = 0;
+
+            while (stack_size > 0) {
+                const uint32_t node_idx = stack[--stack_size];
+                if (skip_static && node_idx == frame.bvh.static_root) continue;
+
+                const BvhNode &node = frame.bvh.nodes[node_idx];
+                if (box_distance(node, pos) >= min_dist) continue;
+
+                if (node.count > 0) {
+                    for (uint32_t i = node.first; i < node.first + node.count; i++) query_item(i);
+                    continue;
+                }
+
+                // Visit the nearer child first
+                const bool left_first = box_distance(frame.bvh.nodes[node.first], pos) <=
+                                        box_distance(frame.bvh.nodes[node.first + 1], pos);
+
+                stack[stack_size++] = left_first ? node.first + 1 : node.first;
+                stack[stack_size++] = left_first ? node.first : node.first + 1;
+            }
+        }
+
+        // Only the dynamic groups are evaluated while the baked distance stays above exact_dist, it bounds the rest
+        void query_scene_within(const FrameData &frame, const glm::vec3 &pos, const float exact_dist, float &min_dist,
+                                size_t &hit_idx) {
+            tile_steps++;
+
+            if (frame.baked) {
+                const float baked = frame.baked->distance(pos);
+                if (baked > exact_dist) {
+                    query_groups(frame, pos, baked, true, min_dist, hit_idx);
+                    return;
+                }
+            }
+
+            query_groups(frame, pos, MAX_DIST, false, min_dist, hit_idx);
+        }
+
+        void query_scene(const FrameData &frame, const glm::vec3 &pos, float &min_dist, size_t &hit_idx) {
+            const float exact_dist = frame.baked ? frame.baked->refine_distance() : 0.0f;
+            query_scene_within(frame, pos, exact_dist, min_dist, hit_idx);
+        }
+
+        glm::vec3 estimate_surface_normal(const FrameData &frame, const glm::vec3 &p, const size_t obj_idx) {
+            return glm::normalize(evaluate_group_gradient(frame.program, frame.program.groups[obj_idx], p).d);
+        }
+
+        float compute_shadow(const FrameData &frame, glm::vec3 origin, const glm::vec3 &direction,
+                             const float dst_to_light) {
+            const float dist_limit = std::min(shadow_max_dist, dst_to_light);
+            const float shadow_intensity = frame.scene.shadow_intensity;
+
+            int num_steps = 0;
+            float total_dist = 0;
+            float result = 1.0f;
+
+            while (total_dist < dist_limit && num_steps < shadow_max_steps) {
+                float dist;
+                size_t hit_idx;
+
+                // Distances that can still darken the penumbra are evaluated exactly
+                const float exact_dist = std::max(frame.baked ? frame.baked->refine_distance() : 0.0f,
+                                                  total_dist / soft_shadow_factor);
+                query_scene_within(frame, origin, exact_dist, dist, hit_idx);
+
+                if (dist < shadow_eps) {
+                    return shadow_intensity;
+                }
+
+                // GLSL min() keeps the first operand when the second is NaN (dist / 0 on the first step)
+                const float penumbra = shadow_intensity + soft_shadow_factor * dist / total_dist;
+                if (penumbra < result) result = penumbra;
+
+                origin = origin + direction * dist;
+                total_dist += dist;
+                num_steps++;
+            }
+
+            return result;
+        }
+
+        glm::vec3 get_ray_direction(const FrameData &frame, const uint32_t px, const uint32_t py) {
+            // Get current UV coordinates
+            const glm::vec2 uv = glm::vec2(static_cast<float>(px), static_cast<float>(py)) /
+                                 glm::vec2(static_cast<float>(frame.width), static_cast<float>(frame.height)) * 2.0f -
+                                 1.0f;
+
+            const glm::vec3 direction = glm::vec3(frame.inv_proj * glm::vec4(uv, 0.0f, 1.0f));
+            return glm::normalize(glm::vec3(frame.view * glm::vec4(direction, 0)));
+        }
+
+        // Moves a hit found relaxed_eps from the surface onto where the ray crosses it. The crossing is bracketed
+        // between the hit and a point about as far behind the surface, rays that only graze the surface keep their
+        // hit.
+        void refine_hit(const FrameData &frame, const glm::vec3 &direction, glm::vec3 &origin, float &total_dist,
+                        float &dist, size_t &hit_idx, int &num_steps) {
+            constexpr int max_refine_steps = 6;
+
+            float curr_dist;
+            size_t curr_idx;
+
+            float lo = 0;
+            float hi = std::max(dist, 0.0f) + frame.scene.relaxed_eps;
+            query_scene(frame, origin + direction * hi, curr_dist, curr_idx);
+            num_steps++;
+            if (curr_dist >= 0) return;
+
+            // Bisect until the bracket is as tight as a plain hit
+            for (int i = 0; i < max_refine_steps && hi - lo > eps; i++) {
+                const float mid = (lo + hi) * 0.5f;
+                query_scene(frame, origin + direction * mid, curr_dist, curr_idx);
+                num_steps++;
+
+                if (curr_dist < 0) {
+                    hi = mid;
+                    continue;
+                }
+
+                lo = mid;
+                dist = curr_dist;
+                hit_idx = curr_idx;
+            }
+
+            origin += direction * lo;
+            total_dist += lo;
+        }
+
+        glm::vec4 march_ray(const FrameData &frame, const glm::vec3 &direction, const RayState &state) {
+            const Scene &scene = frame.scene;
+            glm::vec4 out_pixel(0.0, 0.0, 0.0, 1.0);
+
+            glm::vec3 origin = state.origin;
+
+            // Raymarching
+            int num_steps = state.num_steps;
+            float total_dist = state.total_dist;
+            bool hit_obj = false;
+
+            // Relaxed steps are stretched by omega until one fails
+            float omega = scene.relaxation;
+            const float hit_eps = scene.relaxation > 1 ? scene.relaxed_eps : eps;
+            float prev_dist = 0;
+            float step = 0;
+
+            while (total_dist < max_dist && num_steps < max_steps) {
+                float dist;
+                size_t hit_idx;
+                query_scene(frame, origin, dist, hit_idx);
+
+                // A relaxed step is safe while the unbounding spheres of this point and the last one overlap.
+                // Otherwise it may have skipped a surface, so the ray backs off to where a plain step would have
+                // landed and stops relaxing.
+                if (omega > 1 && std::abs(dist) + prev_dist < step) {
+                    origin -= direction * (step - prev_dist);
+                    total_dist -= step - prev_dist;
+                    omega = 1;
+                    num_steps++;
+                    continue;
+                }
+
+                // Hit object
+                if (dist < hit_eps) {
+                    if (scene.relaxation > 1) {
+                        refine_hit(frame, direction, origin, total_dist, dist, hit_idx, num_steps);
+                    }
+
+                    hit_obj = true;
+                    const SdfGroup &group = frame.program.groups[hit_idx];
+                    const ObjectRecord &curr = frame.program.objects[group.material_object];
+
+                    // The march only carried distances, the color is resolved once here
+                    const glm::vec3 surface_color(query_group(frame, hit_idx, origin));
+
+                    const glm::vec3 hit_point = origin + dist * direction;
+                    const glm::vec3 surface_normal =
+                            estimate_surface_normal(frame, hit_point - eps * direction, hit_idx);
+
+                    // Compute shadows
+                    const glm::vec3 shadow_offset_pos = hit_point + surface_normal * eps * 3.0f;
+                    glm::vec3 light_dir = scene.light_pos - shadow_offset_pos;
+                    const float dist_to_light = glm::length(light_dir);
+                    light_dir = glm::normalize(light_dir);
+                    const float shadow_value = compute_shadow(frame, shadow_offset_pos, light_dir, dist_to_light);
+
+                    // Compute light (Blinn-Phong)
+                    light_dir = glm::normalize(scene.light_pos - hit_point);
+                    const glm::vec3 view_dir = glm::normalize(origin - hit_point);
+                    const glm::vec3 halfway_dir = glm::normalize(view_dir + light_dir);
+
+                    const float specular = std::pow(std::max(glm::dot(halfway_dir, surface_normal), 0.0f),
+                                                    curr.specular);
+                    const float lambertian =
+                            curr.diffuse * glm::clamp(glm::dot(surface_normal, light_dir), 0.0f, 1.0f);
+
+                    glm::vec3 lit_color = (lambertian + specular) * surface_color * scene.light_color * shadow_value;
+
+                    // Gamma correction
+                    lit_color = glm::pow(lit_color, glm::vec3(1.0f / gamma));
+
+                    out_pixel = glm::vec4(lit_color, 1.0);
+                    break;
+                }
+
+                prev_dist = dist;
+                step = dist * omega;
+                origin = origin + direction * step;
+                total_dist += step;
+                num_steps++;
+            }
+
+            // Apply fog to output pixel
+            const float fog_value = glm::clamp((hit_obj ? total_dist : MAX_DIST) / scene.fog_distance, 0.0f, 1.0f);
+            const glm::vec3 fog_out_color = glm::mix(scene.sky_bottom_color, scene.sky_top_color,
+                                                     glm::clamp(direction.y, 0.0f, 1.0f));
+
+            out_pixel = glm::vec4(glm::mix(glm::vec3(out_pixel), fog_out_color, fog_value), 1);
+
+            if (scene.visualize_distances) {
+                const float val = 1 - 5 * static_cast<float>(num_steps) / max_steps;
+                out_pixel = glm::vec4(val, val, val, 1.0f);
+            }
+
+            return out_pixel;
+        }
+
+        glm::vec4 render_pixel(const FrameData &frame, const uint32_t px, const uint32_t py) {
+            return march_ray(frame, get_ray_direction(frame, px, py), {frame.origin, 0, 0});
+        }
+
+        // Scene distance for every point of a packet. Each group's program runs once for the whole packet, see
+        // evaluate_group. BVH nodes are skipped when they are farther away than the closest group for every ray of
+        // the packet, and static groups when the baked field keeps every ray away from them.
+        void query_packet(const FrameData &frame, const float *x, const float *y, const float *z, float *out,
+                          const size_t count) {
+            std::array<float, max_packet_rays> dist;
+            std::fill(out, out + count, MAX_DIST);
+            tile_steps += count;
+
+            bool skip_static = frame.baked != nullptr;
+            if (frame.baked) {
+                for (size_t r = 0; r < count; ++r) {
+                    const float baked = frame.baked->distance({x[r], y[r], z[r]});
+                    if (baked > frame.baked->refine_distance()) out[r] = baked;
+                    else skip_static = false;
+                }
+            }
+
+            const auto query_item = [&](const uint32_t item) {
+                const SdfGroup &group = frame.program.groups[frame.bvh.items[item]];
+                evaluate_group(frame.program, group, x, y, z, dist.data(), count);
+                for (size_t r = 0; r < count; ++r) {
+                    if (dist[r] < out[r]) out[r] = dist[r];
+                }
+            };
+
+            const auto any_closer = [&](const BvhNode &node) {
+                for (size_t r = 0; r < count; ++r) {
+                    if (box_distance(node, {x[r], y[r], z[r]}) < out[r]) return true;
+                }
+                return false;
+            };
+
+            for (uint32_t i = 0; i < frame.bvh.num_unbounded; i++) query_item(i);
+
+            if (frame.bvh.nodes.empty()) return;
+
+            std::array<uint32_t, SceneBvh::MAX_DEPTH> stack;
+            uint32_t stack_size = 1;
+            stack[0] = 0;
+
+            while (stack_size > 0) {
+                const uint32_t node_idx = stack[--stack_size];
+                if (skip_static && node_idx == frame.bvh.static_root) continue;
+
+                const BvhNode &node = frame.bvh.nodes[node_idx];
+                if (!any_closer(node)) continue;
+
+                if (node.count > 0) {
+                    for (uint32_t i = node.first; i < node.first + node.count; i++) query_item(i);
+                    continue;
+                }
+
+                stack[stack_size++] = node.first + 1;
+                stack[stack_size++] = node.first;
+            }
+        }
+
+        // Marches a size x size block of pixels with one shared step. Every ray moves by the smallest distance
+        // found across the packet, which is safe for all of them. Once the rays disagree too much, or one of
+        // them is about to hit, the packet splits into quadrants and finally hands its rays to march_ray.
+        void march_packet(const FrameData &frame, Image &image, const uint32_t x0, const uint32_t y0,
+                          const uint32_t size, float total_dist, int num_steps) {
+            const uint32_t x1 = std::min(x0 + size, frame.width);
+            const uint32_t y1 = std::min(y0 + size, frame.height);
+            if (x0 >= x1 || y0 >= y1) return;
+
+            std::array<glm::vec3, max_packet_rays> directions;
+            std::array<float, max_packet_rays> px, py, pz, dist;
+            size_t count = 0;
+
+            for (uint32_t y = y0; y < y1; ++y) {
+                for (uint32_t x = x0; x < x1; ++x) {
+                    directions[count++] = get_ray_direction(frame, x, y);
+                }
+            }
+
+            const auto finish_rays = [&] {
+                size_t r = 0;
+                for (uint32_t y = y0; y < y1; ++y) {
+                    for (uint32_t x = x0; x < x1; ++x, ++r) {
+                        const RayState state{frame.origin + directions[r] * total_dist, total_dist, num_steps};
+                        image.at(x, y) = march_ray(frame, directions[r], state);
+                    }
+                }
+            };
+
+            // Relaxed like march_ray, a shared step only holds while it holds for every ray
+            float omega = frame.scene.relaxation;
+            float plain_step = 0;
+            float step = 0;
+            std::array<float, max_packet_rays> prev_dist{};
+
+            while (total_dist < max_dist && num_steps < max_steps) {
+                for (size_t r = 0; r < count; ++r) {
+                    const glm::vec3 pos = frame.origin + directions[r] * total_dist;
+                    px[r] = pos.x;
+                    py[r] = pos.y;
+                    pz[r] = pos.z;
+                }
+
+                query_packet(frame, px.data(), py.data(), pz.data(), dist.data(), count);
+
+                if (omega > 1) {
+                    bool overshot = false;
+                    for (size_t r = 0; r < count; ++r) overshot |= std::abs(dist[r]) + prev_dist[r] < step;
+
+                    if (overshot) {
+                        total_dist -= step - plain_step;
+                        omega = 1;
+                        num_steps++;
+                        continue;
+                    }
+                }
+
+                const auto [min_it, max_it] = std::minmax_element(dist.begin(), dist.begin() + count);
+                plain_step = *min_it;
+
+                if (plain_step < eps || plain_step < packet_divergence_ratio * *max_it) {
+                    if (size / 2 < Raymarcher::MIN_PACKET_SIZE) {
+                        finish_rays();
+                        return;
+                    }
+
+                    const uint32_t half = size / 2;
+                    march_packet(frame, image, x0, y0, half, total_dist, num_steps);
+                    march_packet(frame, image, x0 + half, y0, half, total_dist, num_steps);
+                    march_packet(frame, image, x0, y0 + half, half, total_dist, num_steps);
+                    march_packet(frame, image, x0 + half, y0 + half, half, total_dist, num_steps);
+                    return;
+                }
+
+                std::copy(dist.begin(), dist.begin() + count, prev_dist.begin());
+                step = plain_step * omega;
+                total_dist += step;
+                num_steps++;
+            }
+
+            // Every ray ran out of distance or steps together, march_ray only shades the miss
+            finish_rays();
+        }
+    }
+
+    Raymarcher::Raymarcher(ThreadPool &pool, const Traversal traversal) : pool(pool), traversal(traversal) {
+
+    }
+
+    Err Raymarcher::render(const Scene &scene, Image &image, BakedField *const baked_field) const {
+        if (image.width == 0 || image.height == 0) return Err("Cannot render into an empty image.");
+
+        std::expected<SdfProgram, Err> program = compile_scene(scene.root);
+        if (!program) return program.error();
+
+        FrameData frame{scene, std::move(*program), {}, nullptr, {}, {}, {}, image.width, image.height};
+        frame.bvh.update(frame.program, baked_field != nullptr);
+
+        if (baked_field) {
+            baked_field->update(frame.program);
+            if (!baked_field->empty()) frame.baked = baked_field;
+        }
+
+        const float aspect_ratio = static_cast<float>(image.width) / static_cast<float>(image.height);
+        frame.view = glm::inverse(scene.camera.view_matrix());
+        frame.inv_proj = glm::inverse(scene.projection_matrix(aspect_ratio));
+        frame.origin = glm::vec3(frame.view * glm::vec4(0, 0, 0, 1.0));
+
+        const uint32_t tiles_x = ceil_divide(image.width, TILE_SIZE);
+        const uint32_t tiles_y = ceil_divide(image.height, TILE_SIZE);
+
+        std::atomic<uint64_t> steps = 0;
+        pool.parallel_for(tiles_x * tiles_y, [&](const size_t tile) {
+            tile_steps = 0;
+
+            const uint32_t x0 = static_cast<uint32_t>(tile % tiles_x) * TILE_SIZE;
+            const uint32_t y0 = static_cast<uint32_t>(tile / tiles_x) * TILE_SIZE;
+            const uint32_t x1 = std::min(x0 + TILE_SIZE, image.width);
+            const uint32_t y1 = std::min(y0 + TILE_SIZE, image.height);
+
+            if (traversal == Traversal::Packets) {
+                for (uint32_t y = y0; y < y1; y += PACKET_SIZE) {
+                    for (uint32_t x = x0; x < x1; x += PACKET_SIZE) {
+                        march_packet(frame, image, x, y, PACKET_SIZE, 0, 0);
+                    }
+                }
+            } else {
+                for (uint32_t y = y0; y < y1; ++y) {
+                    for (uint32_t x = x0; x < x1; ++x) {
+                        image.at(x, y) = render_pixel(frame, x, y);
+                    }
+                }
+            }
+
+            steps += tile_steps;
+        });
+
+        last_num_steps = steps;
+        return {};
+    }
+}
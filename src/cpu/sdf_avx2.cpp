@@ -0,0 +1,80 @@
+#include <cpu/sdf_simd.h>
+
+// Compiled with AVX2 and FMA enabled. Only reached after active_isa() confirmed support.
+#if defined(RAYMARCHER_X86_SIMD)
+
+#include <cpu/sdf_lanes.h>
+
+#include <immintrin.h>
+
+namespace cpu {
+    namespace {
+        struct Mask {
+            __m256 m;
+        };
+
+        struct Lanes {
+            using Mask = cpu::Mask;
+            static constexpr size_t width = 8;
+
+            __m256 v;
+
+            Lanes(const __m256 v) : v(v) {}
+
+            Lanes(const float s) : v(_mm256_set1_ps(s)) {}
+
+            static Lanes load(const float *p) { return _mm256_loadu_ps(p); }
+
+            void store(float *p) const { _mm256_storeu_ps(p, v); }
+        };
+
+        inline Lanes operator+(const Lanes a, const Lanes b) { return _mm256_add_ps(a.v, b.v); }
+
+        inline Lanes operator-(const Lanes a, const Lanes b) { return _mm256_sub_ps(a.v, b.v); }
+
+        inline Lanes operator*(const Lanes a, const Lanes b) { return _mm256_mul_ps(a.v, b.v); }
+
+        inline Lanes operator/(const Lanes a, const Lanes b) { return _mm256_div_ps(a.v, b.v); }
+
+        inline Lanes operator-(const Lanes a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+        inline Mask operator<(const Lanes a, const Lanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+
+        inline Mask operator>(const Lanes a, const Lanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+
+        inline Mask operator&(const Mask a, const Mask b) { return {_mm256_and_ps(a.m, b.m)}; }
+
+        inline Mask operator|(const Mask a, const Mask b) { return {_mm256_or_ps(a.m, b.m)}; }
+
+        inline Mask operator~(const Mask a) {
+            return {_mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))};
+        }
+
+        inline Lanes min(const Lanes a, const Lanes b) { return _mm256_min_ps(a.v, b.v); }
+
+        inline Lanes max(const Lanes a, const Lanes b) { return _mm256_max_ps(a.v, b.v); }
+
+        inline Lanes abs(const Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+
+        inline Lanes sqrt(const Lanes a) { return _mm256_sqrt_ps(a.v); }
+
+        inline Lanes round(const Lanes a) {
+            return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        }
+
+        inline Lanes select(const Mask m, const Lanes a, const Lanes b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+    }
+
+    void evaluate_batch_avx2(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                             const size_t count) {
+        lanes::evaluate<Lanes>(obj, x, y, z, out, count);
+    }
+}
+
+#else
+
+namespace cpu {
+    void evaluate_batch_avx2(const ObjectRecord &, const float *, const float *, const float *, float *, size_t) {}
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include <cpu/sdf_simd.h>
+
+// Compiled with AVX-512F enabled. Only reached after active_isa() confirmed support.
+#if defined(RAYMARCHER_X86_SIMD)
+
+#include <cpu/sdf_lanes.h>
+
+#include <immintrin.h>
+
+namespace cpu {
+    namespace {
+        struct Mask {
+            __mmask16 m;
+        };
+
+        struct Lanes {
+            using Mask = cpu::Mask;
+            static constexpr size_t width = 16;
+
+            __m512 v;
+
+            Lanes(const __m512 v) : v(v) {}
+
+            Lanes(const float s) : v(_mm512_set1_ps(s)) {}
+
+            static Lanes load(const float *p) { return _mm512_loadu_ps(p); }
+
+            void store(float *p) const { _mm512_storeu_ps(p, v); }
+        };
+
+        inline Lanes operator+(const Lanes a, const Lanes b) { return _mm512_add_ps(a.v, b.v); }
+
+        inline Lanes operator-(const Lanes a, const Lanes b) { return _mm512_sub_ps(a.v, b.v); }
+
+        inline Lanes operator*(const Lanes a, const Lanes b) { return _mm512_mul_ps(a.v, b.v); }
+
+        inline Lanes operator/(const Lanes a, const Lanes b) { return _mm512_div_ps(a.v, b.v); }
+
+        inline Lanes operator-(const Lanes a) { return _mm512_sub_ps(_mm512_setzero_ps(), a.v); }
+
+        inline Mask operator<(const Lanes a, const Lanes b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)}; }
+
+        inline Mask operator>(const Lanes a, const Lanes b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)}; }
+
+        inline Mask operator&(const Mask a, const Mask b) { return {static_cast<__mmask16>(a.m & b.m)}; }
+
+        inline Mask operator|(const Mask a, const Mask b) { return {static_cast<__mmask16>(a.m | b.m)}; }
+
+        inline Mask operator~(const Mask a) { return {static_cast<__mmask16>(~a.m)}; }
+
+        inline Lanes min(const Lanes a, const Lanes b) { return _mm512_min_ps(a.v, b.v); }
+
+        inline Lanes max(const Lanes a, const Lanes b) { return _mm512_max_ps(a.v, b.v); }
+
+        inline Lanes abs(const Lanes a) { return _mm512_abs_ps(a.v); }
+
+        inline Lanes sqrt(const Lanes a) { return _mm512_sqrt_ps(a.v); }
+
+        inline Lanes round(const Lanes a) {
+            return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        }
+
+        inline Lanes select(const Mask m, const Lanes a, const Lanes b) { return _mm512_mask_blend_ps(m.m, b.v, a.v); }
+    }
+
+    void evaluate_batch_avx512(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                               const size_t count) {
+        lanes::evaluate<Lanes>(obj, x, y, z, out, count);
+    }
+}
+
+#else
+
+namespace cpu {
+    void evaluate_batch_avx512(const ObjectRecord &, const float *, const float *, const float *, float *, size_t) {}
+}
+
+#endif
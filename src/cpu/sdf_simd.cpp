@@ -0,0 +1,139 @@
+#include <cpu/sdf_simd.h>
+#include <cpu/sdf.h>
+
+#if defined(RAYMARCHER_X86_SIMD)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace cpu {
+    namespace {
+#if defined(RAYMARCHER_X86_SIMD)
+        struct CpuFeatures {
+            bool avx2 = false;
+            bool avx512 = false;
+        };
+
+        void cpuid(const uint32_t leaf, const uint32_t subleaf, uint32_t (&regs)[4]) {
+#if defined(_MSC_VER)
+            int result[4];
+            __cpuidex(result, static_cast<int>(leaf), static_cast<int>(subleaf));
+            for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(result[i]);
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        }
+
+        // Which register states the OS saves on context switches
+        uint64_t xgetbv() {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            uint32_t eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+        }
+
+        CpuFeatures detect_features() {
+            CpuFeatures features;
+
+            uint32_t regs[4];
+            cpuid(0, 0, regs);
+            const uint32_t max_leaf = regs[0];
+            if (max_leaf < 7) return features;
+
+            cpuid(1, 0, regs);
+            const bool osxsave = regs[2] & (1u << 27);
+            const bool avx = regs[2] & (1u << 28);
+            const bool fma = regs[2] & (1u << 12);
+            if (!osxsave || !avx) return features;
+
+            // XMM and YMM state, then opmask and ZMM state
+            const uint64_t xcr0 = xgetbv();
+            const bool os_avx = (xcr0 & 0x6) == 0x6;
+            const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+            cpuid(7, 0, regs);
+            features.avx2 = os_avx && fma && (regs[1] & (1u << 5));
+            features.avx512 = features.avx2 && os_avx512 && (regs[1] & (1u << 16));
+            return features;
+        }
+
+        const CpuFeatures &cpu_features() {
+            static const CpuFeatures features = detect_features();
+            return features;
+        }
+#endif
+
+        void evaluate_batch_scalar(const ObjectRecord &obj, const float *x, const float *y, const float *z,
+                                   float *out, const size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = find_distance_to_object(obj, glm::vec3(x[i], y[i], z[i]));
+            }
+        }
+
+        using BatchKernel = void (*)(const ObjectRecord &, const float *, const float *, const float *, float *,
+                                     size_t);
+
+        BatchKernel kernel_for(const Isa isa) {
+            switch (isa) {
+                case Isa::AVX2:
+                    return evaluate_batch_avx2;
+                case Isa::AVX512:
+                    return evaluate_batch_avx512;
+                default:
+                    return evaluate_batch_scalar;
+            }
+        }
+    }
+
+    std::string_view isa_name(const Isa isa) {
+        switch (isa) {
+            case Isa::AVX2:
+                return "avx2";
+            case Isa::AVX512:
+                return "avx512";
+            default:
+                return "scalar";
+        }
+    }
+
+    bool isa_supported(const Isa isa) {
+#if defined(RAYMARCHER_X86_SIMD)
+        switch (isa) {
+            case Isa::AVX2:
+                return cpu_features().avx2;
+            case Isa::AVX512:
+                return cpu_features().avx512;
+            default:
+                return true;
+        }
+#else
+        return isa == Isa::Scalar;
+#endif
+    }
+
+    Isa active_isa() {
+        static const Isa isa = isa_supported(Isa::AVX512) ? Isa::AVX512 :
+                               isa_supported(Isa::AVX2) ? Isa::AVX2 : Isa::Scalar;
+        return isa;
+    }
+
+    void evaluate_batch(const ObjectRecord &obj, const float *x, const float *y, const float *z, float *out,
+                        const size_t count) {
+        static const BatchKernel kernel = kernel_for(active_isa());
+        kernel(obj, x, y, z, out, count);
+    }
+
+    bool evaluate_batch(const Isa isa, const ObjectRecord &obj, const float *x, const float *y, const float *z,
+                        float *out, const size_t count) {
+        if (!isa_supported(isa)) return false;
+
+        kernel_for(isa)(obj, x, y, z, out, count);
+        return true;
+    }
+}
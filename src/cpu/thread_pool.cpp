@@ -0,0 +1,118 @@
+#include <cpu/thread_pool.h>
+#include <utils/trace.h>
+
+#include <algorithm>
+
+namespace cpu {
+    ThreadPool::ThreadPool(size_t num_threads) {
+        num_threads = std::max<size_t>(num_threads, 1);
+
+        queues.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; ++i) {
+            queues.emplace_back(std::make_unique<WorkQueue>());
+        }
+
+        workers.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        wake_cv.notify_all();
+
+        for (std::thread &worker: workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::parallel_for(const size_t count, const std::function<void(size_t)> &fn) {
+        if (count == 0) return;
+        TRACE_ZONE("ThreadPool::parallel_for");
+
+        Job job{&fn, count};
+
+        // Count the tasks before publishing them so a fast worker never underflows the counter
+        {
+            std::lock_guard lock(sleep_mutex);
+            pending_tasks += count;
+        }
+
+        // Deal tasks out round-robin so every worker starts with local work
+        for (size_t q = 0; q < queues.size(); ++q) {
+            std::lock_guard lock(queues[q]->mutex);
+            for (size_t i = q; i < count; i += queues.size()) {
+                queues[q]->tasks.push_back({&job, i});
+            }
+        }
+        wake_cv.notify_all();
+
+        // Help out until every task of this job has finished
+        while (job.remaining.load() > 0) {
+            Task task{};
+            if (try_steal(queues.size(), task)) {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock lock(sleep_mutex);
+            done_cv.wait(lock, [&] { return job.remaining.load() == 0; });
+        }
+    }
+
+    void ThreadPool::worker_loop(const size_t worker_idx) {
+        TRACE_THREAD_NAME(std::format("Worker {}", worker_idx));
+        while (true) {
+            Task task{};
+            if (try_pop(worker_idx, task) || try_steal(worker_idx, task)) {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock lock(sleep_mutex);
+            wake_cv.wait(lock, [&] { return stopping || pending_tasks.load() > 0; });
+            if (stopping && pending_tasks.load() == 0) return;
+        }
+    }
+
+    bool ThreadPool::try_pop(const size_t queue_idx, Task &task) {
+        WorkQueue &queue = *queues[queue_idx];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        pending_tasks--;
+        return true;
+    }
+
+    bool ThreadPool::try_steal(const size_t thief_idx, Task &task) {
+        for (size_t offset = 1; offset <= queues.size(); ++offset) {
+            WorkQueue &queue = *queues[(thief_idx + offset) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            pending_tasks--;
+            return true;
+        }
+        return false;
+    }
+
+    void ThreadPool::run(const Task &task) {
+        {
+            TRACE_ZONE("ThreadPool task");
+            (*task.job->fn)(task.index);
+        }
+
+        if (task.job->remaining.fetch_sub(1) == 1) {
+            std::lock_guard lock(sleep_mutex);
+            done_cv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include <editor/profiler.h>
+#include <utils/trace.h>
+#include <imgui.h>
+#include <misc/cpp/imgui_stdlib.h>
+
+#include <format>
+
+namespace editor {
+    void Profiler::update(EditorData &state) {
+        FrameProfiler &profiler = state.profiler;
+
+        ImGui::Begin("Profiler");
+
+        ImGui::SeparatorText("GPU");
+        for (size_t p = 0; p < FrameProfiler::NUM_GPU_PASSES; p++) {
+            pass_graph(FrameProfiler::GPU_PASS_NAMES[p], profiler.gpu_times(static_cast<FrameProfiler::GpuPass>(p)));
+        }
+        ImGui::Text("Frames without GPU times: %llu", static_cast<unsigned long long>(profiler.num_lost_frames()));
+
+        ImGui::SeparatorText("CPU");
+        for (size_t p = 0; p < FrameProfiler::NUM_CPU_PASSES; p++) {
+            pass_graph(FrameProfiler::CPU_PASS_NAMES[p], profiler.cpu_times(static_cast<FrameProfiler::CpuPass>(p)));
+        }
+
+        ImGui::SeparatorText("Export");
+        ImGui::InputText("Path", &csv_path);
+        if (ImGui::Button("Export CSV")) {
+            if (Err err = profiler.export_csv(csv_path)) {
+                err.print();
+                export_status = "Export failed";
+            } else {
+                export_status = std::format("Saved to {}", csv_path);
+            }
+        }
+        if (!export_status.empty()) {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(export_status.c_str());
+        }
+
+        ImGui::SeparatorText("Trace");
+        if (!TRACE_ENABLED) {
+            ImGui::TextDisabled("Built without RAYMARCHER_TRACE");
+        } else {
+            ImGui::InputText("Trace Path", &trace_path);
+            if (ImGui::Button("Write Chrome Trace")) {
+                if (Err err = write_chrome_trace(trace_path)) {
+                    err.print();
+                    trace_status = "Write failed";
+                } else {
+                    trace_status = std::format("Saved to {}", trace_path);
+                }
+            }
+            if (!trace_status.empty()) {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(trace_status.c_str());
+            }
+        }
+
+        ImGui::End();
+    }
+
+    void Profiler::pass_graph(const std::string_view name, const std::vector<float> &times) {
+        const FrameProfiler::Percentiles percentiles = FrameProfiler::percentiles(times);
+        const std::string overlay = std::format("p50 {:.2f}  p95 {:.2f}  p99 {:.2f}  max {:.2f} ms",
+                                                percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max);
+
+        // Scaled to the worst frame, so spikes stay visible
+        ImGui::PlotLines(std::string(name).c_str(), times.data(), static_cast<int>(times.size()), 0, overlay.c_str(),
+                         0, std::max(percentiles.max, 0.1f), ImVec2(0, 48));
+    }
+}
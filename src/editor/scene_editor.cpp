@@ -1,6 +1,7 @@
 #include <editor/scene_editor.h>
 #include <imgui.h>
 #include <misc/cpp/imgui_stdlib.h>
+#include <numeric>
 #include <ranges>
 
 namespace editor {
@@ -16,10 +17,120 @@ namespace editor {
 
         Object &root = state.scene.root;
         object_hierarchy(root, 0);
+        object_costs(state);
 
         ImGui::End();
     }
 
+    void SceneEditor::object_costs(EditorData &state) {
+        if (!ImGui::CollapsingHeader("Object Costs")) return;
+
+        ShaderVariants &shaders = state.shaders;
+        ObjectProfiler &profiler = state.scene_buffers.object_profiler;
+        ImGui::Checkbox("Profile Objects", &shaders.profile_objects);
+        ImGui::Checkbox("Count Clock Cycles", &shaders.profile_cycles);
+        ImGui::Checkbox("Heat View", &profiler.show_heat);
+
+        const ObjectProfiler::Stats &stats = profiler.stats();
+        if (stats.costs.empty()) return;
+
+        const bool has_cycles = stats.total_cycles > 0;
+        ImGui::Text("%llu evaluations, %llu cycles", static_cast<unsigned long long>(stats.total_evals),
+                    static_cast<unsigned long long>(stats.total_cycles));
+
+        constexpr ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Borders |
+                                          ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+        if (!ImGui::BeginTable("Object Costs", 4, flags, ImVec2(0, 240))) return;
+
+        enum Column : unsigned {
+            Name, Evals, Share, Cycles
+        };
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Object", ImGuiTableColumnFlags_WidthStretch, 0, Name);
+        ImGui::TableSetupColumn("Evaluations", ImGuiTableColumnFlags_DefaultSort |
+                                               ImGuiTableColumnFlags_PreferSortDescending, 0, Evals);
+        ImGui::TableSetupColumn("Share", ImGuiTableColumnFlags_PreferSortDescending, 0, Share);
+        ImGui::TableSetupColumn("Cycles", ImGuiTableColumnFlags_PreferSortDescending, 0, Cycles);
+        ImGui::TableHeadersRow();
+
+        // Objects by id, the costs only know their uuid
+        std::unordered_map<uint32_t, Object *> objects;
+        const auto collect = [&](auto &self, Object &object) -> void {
+            objects.emplace(object.uuid(), &object);
+            for (Object &child: object.children) self(self, child);
+        };
+        collect(collect, state.scene.root);
+
+        const auto name_of = [&](const ObjectProfiler::ObjectCost &cost) -> std::string_view {
+            const auto it = objects.find(cost.object_id);
+            return it == objects.end() ? std::string_view("(deleted)") : std::string_view(it->second->name);
+        };
+
+        // Sorted again for every new profiled frame and whenever the sort order changes
+        ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs();
+        const bool resort = sorted_frame != stats.num_profiled_frames || cost_order.size() != stats.costs.size() ||
+                            (sort_specs && sort_specs->SpecsDirty);
+        if (resort) {
+            cost_order.resize(stats.costs.size());
+            std::iota(cost_order.begin(), cost_order.end(), 0);
+            sorted_frame = stats.num_profiled_frames;
+        }
+        if (resort && sort_specs && sort_specs->SpecsCount > 0) {
+            const ImGuiTableColumnSortSpecs &spec = sort_specs->Specs[0];
+
+            const auto less = [&](const size_t a, const size_t b) {
+                const ObjectProfiler::ObjectCost &ca = stats.costs[a];
+                const ObjectProfiler::ObjectCost &cb = stats.costs[b];
+                switch (spec.ColumnIndex) {
+                    case Name:
+                        return name_of(ca) < name_of(cb);
+                    case Cycles:
+                        return ca.cycles < cb.cycles;
+                    default:
+                        return ca.sdf_evals < cb.sdf_evals;
+                }
+            };
+            if (spec.SortDirection == ImGuiSortDirection_Descending) {
+                std::ranges::stable_sort(cost_order, [&](const size_t a, const size_t b) { return less(b, a); });
+            } else {
+                std::ranges::stable_sort(cost_order, less);
+            }
+            sort_specs->SpecsDirty = false;
+        }
+
+        // Only the visible rows are drawn, scenes can have many objects
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(cost_order.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const ObjectProfiler::ObjectCost &cost = stats.costs[cost_order[row]];
+                const auto it = objects.find(cost.object_id);
+                Object *object = it == objects.end() ? nullptr : it->second;
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                const std::string label = std::format("{}##cost{}", name_of(cost), row);
+                if (ImGui::Selectable(label.c_str(), object && object == selected_object,
+                                      ImGuiSelectableFlags_SpanAllColumns) && object) {
+                    selected_object = object;
+                }
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(cost.sdf_evals));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f%%", stats.total_evals ? 100.0 * cost.sdf_evals / stats.total_evals : 0.0);
+                ImGui::TableNextColumn();
+                if (has_cycles) {
+                    ImGui::Text("%llu", static_cast<unsigned long long>(cost.cycles));
+                } else {
+                    ImGui::TextDisabled("-");
+                }
+            }
+        }
+
+        ImGui::EndTable();
+    }
+
     void SceneEditor::scene_editor(EditorData &state) {
         ImGui::Begin("Scene Settings");
 
@@ -40,6 +151,103 @@ namespace editor {
         ImGui::SliderFloat("Shadow Intensity", &scene.shadow_intensity, 0, 1);
         ImGui::Checkbox("Visualize Distances", &scene.visualize_distances);
 
+        ImGui::SeparatorText("Marching");
+        ImGui::SliderFloat("Relaxation", &scene.relaxation, 1, 2);
+        ImGui::SliderFloat("Relaxed Hit Distance", &scene.relaxed_eps, 0.01f, 0.2f);
+
+        ImGui::SeparatorText("Rendering");
+        ImGui::Checkbox("Render On Demand", &state.render_on_demand.enabled);
+
+        ImGui::SeparatorText("Dynamic Resolution");
+        ResolutionGovernor &governor = state.governor;
+        ImGui::Checkbox("Scale Resolution", &governor.enabled);
+        ImGui::SliderFloat("Target GPU Time (ms)", &governor.target_ms, 2, 50);
+        ImGui::DragFloatRange2("Scale Bounds", &governor.min_scale, &governor.max_scale, 0.01f, 0.25f, 1.0f);
+        ImGui::SliderFloat("Hysteresis", &governor.hysteresis, 0.0f, 0.5f);
+
+        const ResolutionGovernor::Stats &governor_stats = governor.stats();
+        ImGui::Text("Scale: %.2f (%ux%u), GPU time: %.2f ms", governor.scale(), state.renderer.image_width(),
+                    state.renderer.image_height(), governor_stats.gpu_ms);
+        ImGui::Text("Scale changes: %llu", static_cast<unsigned long long>(governor_stats.num_changes));
+
+        ImGui::SeparatorText("Shader");
+        ImGui::Checkbox("Specialize Shader", &state.shaders.specialize);
+
+        const ShaderVariants::Stats &shader_stats = state.shaders.stats();
+        ImGui::Text("Active: %s", shader_stats.specialized ? "Specialized"
+                                  : shader_stats.compiling ? "Generic (compiling variant)" : "Generic");
+        ImGui::Text("Cached variants: %zu, compiled: %zu, failed: %zu", state.shaders.size(),
+                    shader_stats.num_compiles, shader_stats.num_failures);
+
+        SceneBuffers &buffers = state.scene_buffers;
+        ImGui::SeparatorText("Scene Uploads");
+
+        const SceneBuffers::UploadStats &uploads = buffers.uploads;
+        ImGui::Text("Last frame: %zu bytes of %zu", uploads.frame_bytes, uploads.scene_bytes);
+        ImGui::Text("Total: %.2f MB, %llu frames without uploads", uploads.total_bytes / (1024.0 * 1024.0),
+                    static_cast<unsigned long long>(uploads.num_skipped_frames));
+
+        ImGui::SeparatorText("Baked Static Geometry");
+        ImGui::Checkbox("Bake Static Objects", &buffers.bake_static);
+        ImGui::SliderFloat("Cell Size", &buffers.baked_field.cell_size, 0.125f, 4.0f);
+
+        const BakedField::Stats &bake_stats = buffers.baked_field.stats();
+        ImGui::Text("Cells: %zu, bricks: %zu, %.2f MB on the GPU", bake_stats.num_cells, bake_stats.num_bricks,
+                    buffers.baked_textures.memory_bytes() / (1024.0 * 1024.0));
+        ImGui::Text("Last bake: %zu cells in %.2f ms", bake_stats.num_baked_cells, bake_stats.bake_ms);
+        ImGui::Text("Full bakes: %zu, partial: %zu", bake_stats.num_full_bakes, bake_stats.num_partial_bakes);
+
+        ImGui::SeparatorText("Tile Culling");
+        ImGui::Checkbox("Cull Per Screen Tile", &buffers.cull_tiles);
+
+        const TileCuller::Stats &tile_stats = buffers.tile_culler.stats();
+        ImGui::Text("Tile size: %ux%u, %u tiles", tile_stats.tile_size, tile_stats.tile_size, tile_stats.num_tiles);
+        ImGui::Text("Groups per tile: %.1f average, %u max", tile_stats.average_groups, tile_stats.max_groups);
+        ImGui::Text("Overflowing tiles: %u (limit %u groups)", tile_stats.num_overflowing,
+                    TileCuller::MAX_TILE_GROUPS);
+
+        ImGui::SeparatorText("Cone Pre-Pass");
+        ImGui::Checkbox("March Cones First", &buffers.cone_prepass.enabled);
+        ImGui::Text("Cell size: %ux%u pixels", ConePrepass::CELL_SIZE, ConePrepass::CELL_SIZE);
+
+        ImGui::SeparatorText("Object Staging");
+        ImGui::Checkbox("Stage Objects in Shared Memory", &buffers.object_staging.enabled);
+
+        const ObjectStaging::Stats &staging_stats = buffers.object_staging.stats();
+        ImGui::Text("Staged: %u of %u objects (limit %u)", staging_stats.num_staged, staging_stats.num_objects,
+                    ObjectStaging::MAX_STAGED_OBJECTS);
+        ImGui::Text("Raymarching: %.3f ms staged, %.3f ms from the object buffer", staging_stats.staged_ms,
+                    staging_stats.baseline_ms);
+
+        ImGui::SeparatorText("March Statistics");
+        ImGui::Checkbox("Count March Work", &buffers.march_stats.enabled);
+
+        const MarchStats::Stats &march_stats = buffers.march_stats.stats();
+        if (march_stats.num_pixels > 0) {
+            const auto per_pixel = [&](const uint64_t count) {
+                return static_cast<double>(count) / static_cast<double>(march_stats.num_pixels);
+            };
+            const auto percent = [&](const uint64_t count) { return per_pixel(count) * 100; };
+
+            ImGui::Text("Per pixel: %.2f steps, %.2f shadow steps, %.1f SDF evaluations",
+                        per_pixel(march_stats.march_steps), per_pixel(march_stats.shadow_steps),
+                        per_pixel(march_stats.sdf_evals));
+            ImGui::Text("Totals: %llu steps, %llu shadow steps, %llu SDF evaluations",
+                        static_cast<unsigned long long>(march_stats.march_steps),
+                        static_cast<unsigned long long>(march_stats.shadow_steps),
+                        static_cast<unsigned long long>(march_stats.sdf_evals));
+            ImGui::Text("Hits: %.1f%%, misses: %.1f%%, out of steps: %.1f%%", percent(march_stats.num_hits),
+                        percent(march_stats.num_misses), percent(march_stats.num_exhausted));
+
+            std::array<float, MarchStats::HISTOGRAM_BINS> histogram{};
+            for (size_t bin = 0; bin < histogram.size(); bin++) {
+                histogram[bin] = static_cast<float>(percent(march_stats.step_histogram[bin]));
+            }
+            const std::string overlay = std::format("% of pixels per {} steps", MarchStats::HISTOGRAM_BIN_STEPS);
+            ImGui::PlotHistogram("Steps", histogram.data(), static_cast<int>(histogram.size()), 0, overlay.c_str(),
+                                 0, 100, ImVec2(0, 64));
+        }
+
         ImGui::End();
     }
 
@@ -57,8 +265,10 @@ namespace editor {
         // Modify Type
         if (ImGui::BeginCombo("Type", obj_type_mapping.at(object.obj_type).data())) {
             for (const auto &[obj_type, type_string]: obj_type_mapping) {
-                if (ImGui::Selectable(obj_type_mapping.at(obj_type).data(), obj_type == object.obj_type))
+                if (ImGui::Selectable(obj_type_mapping.at(obj_type).data(), obj_type == object.obj_type)) {
                     object.obj_type = obj_type;
+                    object.dirty = true;
+                }
             }
             ImGui::EndCombo();
         }
@@ -66,21 +276,26 @@ namespace editor {
         ImGui::Separator();
 
         // Position, scale color
-        ImGui::DragFloat3("Position", (float *) &object.pos, 0.125f);
-        ImGui::DragFloat3("Scale", (float *) &object.scale, 0.125f);
+        object.dirty |= ImGui::DragFloat3("Position", (float *) &object.pos, 0.125f);
+        object.dirty |= ImGui::DragFloat3("Scale", (float *) &object.scale, 0.125f);
 
         ImGui::Separator();
-        ImGui::ColorEdit3("Color", (float *) &object.color);
-        ImGui::SliderFloat("Diffuse", &object.diffuse, 0.0f, 2.0f);
-        ImGui::SliderFloat("Specular", &object.specular, 1.0f, 200.0f);
+        object.dirty |= ImGui::ColorEdit3("Color", (float *) &object.color);
+        object.dirty |= ImGui::SliderFloat("Diffuse", &object.diffuse, 0.0f, 2.0f);
+        object.dirty |= ImGui::SliderFloat("Specular", &object.specular, 1.0f, 200.0f);
+
+        ImGui::Separator();
+        object.dirty |= ImGui::Checkbox("Static", &object.is_static);
 
         ImGui::Separator();
 
         // Modify link type
         if (ImGui::BeginCombo("Link Type", link_type_mapping.at(object.link_type).data())) {
             for (const auto &[link_type, type_string]: link_type_mapping) {
-                if (ImGui::Selectable(link_type_mapping.at(link_type).data(), link_type == object.link_type))
+                if (ImGui::Selectable(link_type_mapping.at(link_type).data(), link_type == object.link_type)) {
                     object.link_type = link_type;
+                    object.dirty = true;
+                }
             }
             ImGui::EndCombo();
         }
@@ -94,11 +309,12 @@ namespace editor {
 
         SceneEditor::Action result = Action::NONE;
 
-        // Button to add child
-        if (level < 2) {
+        // Button to add child, every nesting level needs its own register in the compiled program
+        if (level < SDF_MAX_REGISTERS) {
             if (ImGui::Button(std::format("+##{}", object.uuid()).c_str())) {
                 object.children.emplace_back(
                         Object(std::format("{} child", object.name), ObjectType::Box, {0, 0, 0}, {1, 1, 1}, {1, 1, 1}));
+                object.dirty = true;
             }
             ImGui::SameLine();
         }
@@ -124,7 +340,10 @@ namespace editor {
             if (child_result == Action::DELETE_OBJ) delete_idx = i;
         }
 
-        if (delete_idx >= 0) object.children.erase(object.children.begin() + delete_idx);
+        if (delete_idx >= 0) {
+            object.children.erase(object.children.begin() + delete_idx);
+            object.dirty = true;
+        }
 
         return result;
     }
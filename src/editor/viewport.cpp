@@ -6,11 +6,12 @@ namespace editor {
 
         ImGui::Begin("Viewport");
 
-        // Fill viewport with current image
+        // Fill viewport with current image, upscaled from the part of the texture it was rendered to
         const float vp_width = ImGui::GetWindowWidth();
         const float vp_height = ImGui::GetWindowHeight();
-        const float img_width = state.renderer.image_width();
-        const float img_height = state.renderer.image_height();
+        const float img_width = state.renderer.texture_width();
+        const float img_height = state.renderer.texture_height();
+        const glm::vec2 extent = state.renderer.image_extent();
 
         const float horizontal_scale = vp_width / img_width;
         const float vertical_scale = vp_height / img_height;
@@ -22,8 +23,30 @@ namespace editor {
 
         ImGui::SetCursorPos(offset_xy);
         ImGui::Image((ImTextureID) state.renderer.texture(), ImVec2(img_width * scale, img_height * scale),
-                     ImVec2(0, 1),
-                     ImVec2(1, 0));
+                     ImVec2(0, extent.y),
+                     ImVec2(extent.x, 0));
+
+        // Stats overlay in the image's top left corner
+        const ConePrepass &cone_prepass = state.scene_buffers.cone_prepass;
+        const ConePrepass::Stats &step_stats = cone_prepass.stats();
+        ImGui::SetCursorPos({offset_xy.x + 8, offset_xy.y + 8});
+        if (cone_prepass.enabled) {
+            ImGui::Text("Steps/pixel: %.2f with cone pre-pass (%.2f + %.2f in cones), %.2f without",
+                        step_stats.steps_per_pixel + step_stats.cone_steps_per_pixel, step_stats.steps_per_pixel,
+                        step_stats.cone_steps_per_pixel, step_stats.baseline_steps_per_pixel);
+        } else {
+            ImGui::Text("Steps/pixel: %.2f without cone pre-pass", step_stats.baseline_steps_per_pixel);
+        }
+
+        const ResolutionGovernor::Stats &governor_stats = state.governor.stats();
+        ImGui::SetCursorPosX(offset_xy.x + 8);
+        ImGui::Text("Resolution: %ux%u (%.0f%%), GPU time: %.2f ms", state.renderer.image_width(),
+                    state.renderer.image_height(), state.governor.scale() * 100, governor_stats.gpu_ms);
+
+        const RenderOnDemand::Stats &frame_stats = state.render_on_demand.stats();
+        ImGui::SetCursorPosX(offset_xy.x + 8);
+        ImGui::Text("Frames skipped: %llu of %llu", static_cast<unsigned long long>(frame_stats.num_skipped),
+                    static_cast<unsigned long long>(frame_stats.num_skipped + frame_stats.num_rendered));
 
         // Control scene camera
         if (ImGui::IsWindowFocused() && ImGui::IsAnyMouseDown()) {
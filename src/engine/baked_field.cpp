@@ -0,0 +1,426 @@
+#include <engine/baked_field.h>
+#include <cpu/program_eval.h>
+#include <utils/algo.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr float sqrt3 = 1.7320508f;
+
+    // In voxels of the bound a cell needs to get by without a brick
+    constexpr float brick_threshold = 2.0f;
+
+    // FNV-1a over what shapes a group's distance. Colors and materials are left out, editing them needs no bake.
+    uint64_t group_signature(const SdfProgram &program, const SdfGroup &group) {
+        uint64_t value = 14695981039346656037ull;
+        const auto add = [&](const uint32_t word) {
+            for (int i = 0; i < 4; i++) {
+                value ^= (word >> (i * 8)) & 0xFFu;
+                value *= 1099511628211ull;
+            }
+        };
+
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+            add(static_cast<uint32_t>(inst.op));
+            add(inst.dst);
+
+            if (inst.op != SdfOp::Eval) {
+                add(inst.arg);
+                continue;
+            }
+
+            const ObjectRecord &obj = program.objects[inst.arg];
+            add(static_cast<uint32_t>(obj.type));
+            for (int c = 0; c < 3; c++) {
+                add(std::bit_cast<uint32_t>(obj.pos[c]));
+                add(std::bit_cast<uint32_t>(obj.scale[c]));
+            }
+        }
+
+        return value;
+    }
+
+    Aabb node_bounds(const BvhNode &node) {
+        return {node.min, node.max};
+    }
+}
+
+bool BakedField::update(const SdfProgram &program) {
+    using clock = std::chrono::steady_clock;
+
+    cells_changed = false;
+    changed_slots.clear();
+
+    bvh.update(program, true);
+    group_bounds = compute_group_bounds(program);
+
+    std::vector<BakedGroup> groups;
+    Aabb new_bounds = Aabb::empty();
+    for (size_t i = 0; i < program.groups.size(); i++) {
+        if (!(program.groups[i].flags & SDF_GROUP_STATIC)) continue;
+
+        groups.push_back({group_signature(program, program.groups[i]), group_bounds[i]});
+        new_bounds = new_bounds.merge(group_bounds[i]);
+    }
+
+    if (groups.empty()) {
+        const bool had_field = !empty();
+        clear();
+        cells_changed = had_field;
+        return had_field;
+    }
+
+    const clock::time_point start = clock::now();
+    const Aabb grid{origin, origin + glm::vec3(dims) * cell};
+    const bool full = empty() || groups.size() != baked_groups.size() || cell_size != baked_cell_size ||
+                      !grid.contains(new_bounds.expand(cell));
+
+    if (full) {
+        bounds = new_bounds;
+        baked_groups = std::move(groups);
+        bake_all(program);
+    } else {
+        // Old and new bounds of every group that changed shape or moved
+        std::vector<Aabb> edits;
+        for (size_t i = 0; i < groups.size(); i++) {
+            if (groups[i].signature != baked_groups[i].signature) {
+                edits.push_back(groups[i].bounds.merge(baked_groups[i].bounds));
+            }
+        }
+
+        bounds = new_bounds;
+        baked_groups = std::move(groups);
+        if (edits.empty()) return false;
+
+        // A cell's samples and bound only depend on surfaces within this distance of it
+        const float reach = cell * sqrt3 + cell;
+        std::vector<bool> dirty(coarse.size(), false);
+
+        for (const Aabb &edit: edits) {
+            // Farther cells only have their bound lowered to where the edited group can now be
+            size_t idx = 0;
+            for (uint32_t z = 0; z < dims.z; z++) {
+                for (uint32_t y = 0; y < dims.y; y++) {
+                    for (uint32_t x = 0; x < dims.x; x++, idx++) {
+                        coarse[idx] = std::min(coarse[idx], cell_bounds({x, y, z}).distance(edit));
+                    }
+                }
+            }
+
+            const Aabb touched = edit.expand(reach);
+            const glm::ivec3 lo = glm::max(glm::ivec3(glm::floor((touched.min - origin) / cell)), 0);
+            const glm::ivec3 hi = glm::min(glm::ivec3(glm::floor((touched.max - origin) / cell)),
+                                           glm::ivec3(dims) - 1);
+
+            for (int z = lo.z; z <= hi.z; z++) {
+                for (int y = lo.y; y <= hi.y; y++) {
+                    for (int x = lo.x; x <= hi.x; x++) {
+                        dirty[x + dims.x * (y + dims.y * z)] = true;
+                    }
+                }
+            }
+        }
+
+        bake_stats.num_baked_cells = 0;
+        for (size_t i = 0; i < dirty.size(); i++) {
+            if (!dirty[i]) continue;
+            bake_cell(program, i);
+            bake_stats.num_baked_cells++;
+        }
+
+        cells_changed = true;
+        bake_stats.num_partial_bakes++;
+    }
+
+    bake_stats.bake_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    update_memory_stats();
+    return true;
+}
+
+void BakedField::clear() {
+    origin = glm::vec3(0);
+    cell = 0;
+    dims = glm::uvec3(0);
+    bounds = Aabb::empty();
+
+    coarse.clear();
+    bricks.clear();
+    atlas.clear();
+    free_slots.clear();
+    baked_groups.clear();
+    baked_cell_size = 0;
+
+    update_memory_stats();
+}
+
+float BakedField::distance(const glm::vec3 &pos) const {
+    const glm::vec3 local = (pos - origin) / cell;
+    if (glm::any(glm::lessThan(local, glm::vec3(0))) || glm::any(glm::greaterThanEqual(local, glm::vec3(dims)))) {
+        return bounds.distance(pos);
+    }
+
+    const glm::uvec3 c(local);
+    const size_t idx = c.x + dims.x * (c.y + dims.y * c.z);
+    const uint32_t slot = bricks[idx];
+    if (slot == NO_BRICK) return coarse[idx];
+
+    // Samples sit on the cell's corners and split it into BRICK_SIZE - 1 voxels per axis
+    const glm::vec3 f = (local - glm::vec3(c)) * static_cast<float>(BRICK_SIZE - 1);
+    const glm::uvec3 i0 = glm::min(glm::uvec3(f), glm::uvec3(BRICK_SIZE - 2));
+    const glm::vec3 t = f - glm::vec3(i0);
+
+    const float *samples = &atlas[static_cast<size_t>(slot) * BRICK_SAMPLES];
+    const auto at = [&](const uint32_t x, const uint32_t y, const uint32_t z) {
+        return samples[(i0.x + x) + BRICK_SIZE * ((i0.y + y) + BRICK_SIZE * (i0.z + z))];
+    };
+
+    const float x00 = std::lerp(at(0, 0, 0), at(1, 0, 0), t.x);
+    const float x10 = std::lerp(at(0, 1, 0), at(1, 1, 0), t.x);
+    const float x01 = std::lerp(at(0, 0, 1), at(1, 0, 1), t.x);
+    const float x11 = std::lerp(at(0, 1, 1), at(1, 1, 1), t.x);
+    const float value = std::lerp(std::lerp(x00, x10, t.y), std::lerp(x01, x11, t.y), t.z);
+
+    return value - sample_margin();
+}
+
+float BakedField::refine_distance() const {
+    return cell / static_cast<float>(BRICK_SIZE - 1);
+}
+
+float BakedField::sample_margin() const {
+    return 0.5f * sqrt3 * refine_distance();
+}
+
+void BakedField::bake_all(const SdfProgram &program) {
+    // Every static surface has to stay at least a cell inside the grid, the second cell of padding leaves room
+    // for edits near the edge to be baked partially
+    const glm::vec3 extent = bounds.max - bounds.min + 4.0f * cell_size;
+    cell = std::max(cell_size, std::max(extent.x, std::max(extent.y, extent.z)) / MAX_CELLS_PER_AXIS);
+
+    const Aabb grid = bounds.expand(2.0f * cell);
+    origin = grid.min;
+    dims = glm::max(glm::uvec3(glm::ceil((grid.max - grid.min) / cell)), glm::uvec3(1));
+    baked_cell_size = cell_size;
+
+    const size_t num_cells = static_cast<size_t>(dims.x) * dims.y * dims.z;
+    coarse.assign(num_cells, 0);
+    bricks.assign(num_cells, NO_BRICK);
+    atlas.clear();
+    free_slots.clear();
+
+    for (size_t i = 0; i < num_cells; i++) bake_cell(program, i);
+
+    cells_changed = true;
+    bake_stats.num_baked_cells = num_cells;
+    bake_stats.num_full_bakes++;
+}
+
+void BakedField::bake_cell(const SdfProgram &program, const size_t cell_idx) {
+    const glm::uvec3 cell_pos(cell_idx % dims.x, (cell_idx / dims.x) % dims.y, cell_idx / (dims.x * dims.y));
+    const Aabb box = cell_bounds(cell_pos);
+    const float diagonal = cell * sqrt3;
+
+    // Every point of the cell is within half a diagonal of its center
+    const float center = static_distance(program, box.center(), std::numeric_limits<float>::max());
+    coarse[cell_idx] = center - 0.5f * diagonal;
+
+    // Cells whose bound stays a few voxels above refine_distance() can do without a brick
+    uint32_t &slot = bricks[cell_idx];
+    if (std::abs(center) >= 0.5f * diagonal + brick_threshold * refine_distance()) {
+        if (slot != NO_BRICK) free_slot(slot);
+        slot = NO_BRICK;
+        return;
+    }
+
+    if (slot == NO_BRICK) slot = allocate_slot();
+    changed_slots.push_back(slot);
+
+    std::array<float, BRICK_SAMPLES> x, y, z, dist;
+    const float voxel = refine_distance();
+    for (uint32_t i = 0; i < BRICK_SAMPLES; i++) {
+        x[i] = box.min.x + static_cast<float>(i % BRICK_SIZE) * voxel;
+        y[i] = box.min.y + static_cast<float>((i / BRICK_SIZE) % BRICK_SIZE) * voxel;
+        z[i] = box.min.z + static_cast<float>(i / (BRICK_SIZE * BRICK_SIZE)) * voxel;
+    }
+
+    // Groups farther than a cell from the brick are at least that far from every sample, which caps the samples
+    float *samples = &atlas[static_cast<size_t>(slot) * BRICK_SAMPLES];
+    std::fill(samples, samples + BRICK_SAMPLES, cell);
+
+    std::vector<uint32_t> candidates;
+    gather_static(box, cell, candidates);
+
+    for (const uint32_t group: candidates) {
+        cpu::evaluate_group(program, program.groups[group], x.data(), y.data(), z.data(), dist.data(),
+                            BRICK_SAMPLES);
+        for (uint32_t i = 0; i < BRICK_SAMPLES; i++) samples[i] = std::min(samples[i], dist[i]);
+    }
+}
+
+Aabb BakedField::cell_bounds(const glm::uvec3 &cell_pos) const {
+    const glm::vec3 min = origin + glm::vec3(cell_pos) * cell;
+    return {min, min + cell};
+}
+
+float BakedField::static_distance(const SdfProgram &program, const glm::vec3 &pos, const float limit) const {
+    float min_dist = limit;
+    if (bvh.static_root == SceneBvh::NO_NODE) return min_dist;
+
+    std::array<uint32_t, SceneBvh::MAX_DEPTH> stack;
+    uint32_t stack_size = 1;
+    stack[0] = bvh.static_root;
+
+    while (stack_size > 0) {
+        const BvhNode &node = bvh.nodes[stack[--stack_size]];
+        if (node_bounds(node).distance(pos) >= min_dist) continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                min_dist = std::min(min_dist, cpu::evaluate_group(program, program.groups[bvh.items[i]], pos));
+            }
+            continue;
+        }
+
+        const bool left_first = node_bounds(bvh.nodes[node.first]).distance(pos) <=
+                                node_bounds(bvh.nodes[node.first + 1]).distance(pos);
+
+        stack[stack_size++] = left_first ? node.first + 1 : node.first;
+        stack[stack_size++] = left_first ? node.first : node.first + 1;
+    }
+
+    return min_dist;
+}
+
+void BakedField::gather_static(const Aabb &box, const float reach, std::vector<uint32_t> &out) const {
+    out.clear();
+    if (bvh.static_root == SceneBvh::NO_NODE) return;
+
+    std::array<uint32_t, SceneBvh::MAX_DEPTH> stack;
+    uint32_t stack_size = 1;
+    stack[0] = bvh.static_root;
+
+    while (stack_size > 0) {
+        const BvhNode &node = bvh.nodes[stack[--stack_size]];
+        if (node_bounds(node).distance(box) >= reach) continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                const uint32_t idx = bvh.items[i];
+                if (group_bounds[idx].distance(box) < reach) out.push_back(idx);
+            }
+            continue;
+        }
+
+        stack[stack_size++] = node.first + 1;
+        stack[stack_size++] = node.first;
+    }
+}
+
+uint32_t BakedField::allocate_slot() {
+    if (!free_slots.empty()) {
+        const uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+
+    atlas.resize(atlas.size() + BRICK_SAMPLES);
+    return num_slots() - 1;
+}
+
+void BakedField::free_slot(const uint32_t slot) {
+    free_slots.push_back(slot);
+}
+
+void BakedField::update_memory_stats() {
+    bake_stats.num_cells = coarse.size();
+    bake_stats.num_bricks = num_slots() - free_slots.size();
+    bake_stats.memory_bytes = coarse.size() * sizeof(float) + bricks.size() * sizeof(uint32_t) +
+                              atlas.size() * sizeof(float);
+}
+
+Err BakedFieldTextures::init() {
+    glGenTextures(1, &coarse_id);
+    glGenTextures(1, &bricks_id);
+    glGenTextures(1, &atlas_id);
+
+    for (const GLuint texture: {coarse_id, bricks_id, atlas_id}) {
+        const GLint filter = texture == atlas_id ? GL_LINEAR : GL_NEAREST;
+
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, filter);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create baked field textures. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+Err BakedFieldTextures::upload(const BakedField &field) {
+    if (field.empty()) return {};
+
+    if (field.cells_changed || field.dims != cell_dims) {
+        cell_dims = field.dims;
+
+        glBindTexture(GL_TEXTURE_3D, coarse_id);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, cell_dims.x, cell_dims.y, cell_dims.z, 0, GL_RED, GL_FLOAT,
+                     field.coarse.data());
+
+        glBindTexture(GL_TEXTURE_3D, bricks_id);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, cell_dims.x, cell_dims.y, cell_dims.z, 0, GL_RED_INTEGER,
+                     GL_UNSIGNED_INT, field.bricks.data());
+    }
+
+    glBindTexture(GL_TEXTURE_3D, atlas_id);
+
+    constexpr uint32_t bricks_per_layer = ATLAS_BRICKS * ATLAS_BRICKS;
+    const uint32_t needed_layers = std::max(ceil_divide(field.num_slots(), bricks_per_layer), 1u);
+    if (needed_layers > atlas_layers) {
+        // Grow geometrically so bakes that add a few bricks at a time do not reallocate every time
+        atlas_layers = std::max(needed_layers, atlas_layers * 2);
+
+        constexpr GLsizei side = ATLAS_BRICKS * BakedField::BRICK_SIZE;
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, side, side, atlas_layers * BakedField::BRICK_SIZE, 0, GL_RED,
+                     GL_FLOAT, nullptr);
+        for (uint32_t slot = 0; slot < field.num_slots(); slot++) upload_slot(field, slot);
+    } else {
+        for (const uint32_t slot: field.changed_slots) upload_slot(field, slot);
+    }
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to upload the baked field. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+void BakedFieldTextures::upload_slot(const BakedField &field, const uint32_t slot) const {
+    constexpr GLsizei size = BakedField::BRICK_SIZE;
+    glTexSubImage3D(GL_TEXTURE_3D, 0, (slot % ATLAS_BRICKS) * size, (slot / ATLAS_BRICKS % ATLAS_BRICKS) * size,
+                    slot / (ATLAS_BRICKS * ATLAS_BRICKS) * size, size, size, size, GL_RED, GL_FLOAT,
+                    &field.atlas[static_cast<size_t>(slot) * BakedField::BRICK_SAMPLES]);
+}
+
+void BakedFieldTextures::bind() const {
+    glBindTextureUnit(COARSE_UNIT, coarse_id);
+    glBindTextureUnit(BRICKS_UNIT, bricks_id);
+    glBindTextureUnit(ATLAS_UNIT, atlas_id);
+}
+
+size_t BakedFieldTextures::memory_bytes() const {
+    constexpr size_t atlas_layer_bytes = ATLAS_BRICKS * ATLAS_BRICKS * BakedField::BRICK_SAMPLES * sizeof(float);
+    return static_cast<size_t>(cell_dims.x) * cell_dims.y * cell_dims.z * (sizeof(float) + sizeof(uint32_t)) +
+           atlas_layers * atlas_layer_bytes;
+}
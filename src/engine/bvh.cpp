@@ -0,0 +1,273 @@
+#include <engine/bvh.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Refitting stops paying off once moving groups has grown the tree's surface area this much
+    constexpr float max_refit_cost_ratio = 2.0f;
+
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    enum class BoundKind {
+        Empty, Finite, Infinite
+    };
+
+    BoundKind kind(const Aabb &box) {
+        if (box.is_empty()) return BoundKind::Empty;
+        return box.is_finite() ? BoundKind::Finite : BoundKind::Infinite;
+    }
+
+    // Box around everything find_distance_to_object can place at or below zero
+    Aabb object_bounds(const ObjectRecord &obj) {
+        const glm::vec3 s = glm::abs(obj.scale);
+        glm::vec3 extent;
+
+        switch (obj.type) {
+            case ObjectType::Sphere:
+            case ObjectType::Octohedron:
+                extent = glm::vec3(s.x);
+                break;
+            case ObjectType::Box:
+                extent = s;
+                break;
+            case ObjectType::Torus:
+                extent = glm::vec3(s.x + s.y, s.y, s.x + s.y);
+                break;
+            case ObjectType::RoundBox:
+                // Rounding with r = 0.1 only shrinks the box, unless it is thinner than the radius
+                extent = glm::abs(obj.scale - 0.1f) + 0.1f;
+                break;
+            case ObjectType::HexPrism:
+                // Circumradius of a hexagon with apothem h.x
+                extent = glm::vec3(s.x * 1.1547006f, s.x * 1.1547006f, s.y);
+                break;
+            case ObjectType::InfiniteSpheres:
+            case ObjectType::GridPlane:
+                return Aabb::infinite();
+            default:
+                return Aabb::empty();
+        }
+
+        return {obj.pos - extent, obj.pos + extent};
+    }
+}
+
+Aabb Aabb::empty() {
+    return {glm::vec3(inf), glm::vec3(-inf)};
+}
+
+Aabb Aabb::infinite() {
+    return {glm::vec3(-inf), glm::vec3(inf)};
+}
+
+bool Aabb::is_empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+bool Aabb::is_finite() const {
+    for (int i = 0; i < 3; i++) {
+        if (std::isinf(min[i]) || std::isinf(max[i])) return false;
+    }
+    return true;
+}
+
+Aabb Aabb::merge(const Aabb &other) const {
+    return {glm::min(min, other.min), glm::max(max, other.max)};
+}
+
+Aabb Aabb::intersect(const Aabb &other) const {
+    return {glm::max(min, other.min), glm::min(max, other.max)};
+}
+
+Aabb Aabb::expand(const float amount) const {
+    return {min - amount, max + amount};
+}
+
+bool Aabb::contains(const Aabb &other) const {
+    return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+}
+
+float Aabb::surface_area() const {
+    if (is_empty()) return 0;
+
+    const glm::vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+float Aabb::distance(const glm::vec3 &pos) const {
+    return glm::length(glm::max(glm::max(min - pos, pos - max), 0.0f));
+}
+
+float Aabb::distance(const Aabb &other) const {
+    return glm::length(glm::max(glm::max(min - other.max, other.min - max), 0.0f));
+}
+
+std::vector<Aabb> compute_group_bounds(const SdfProgram &program) {
+    std::vector<Aabb> bounds;
+    bounds.reserve(program.groups.size());
+
+    std::array<Aabb, SDF_MAX_REGISTERS> regs;
+    for (const SdfGroup &group: program.groups) {
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+            Aabb &dst = regs[inst.dst];
+
+            switch (inst.op) {
+                case SdfOp::Eval:
+                    dst = object_bounds(program.objects[inst.arg]);
+                    break;
+                case SdfOp::Union:
+                case SdfOp::SmoothUnion:
+                    dst = dst.merge(regs[inst.arg]);
+                    break;
+                case SdfOp::Intersect:
+                    dst = dst.intersect(regs[inst.arg]);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        bounds.push_back(regs[0]);
+    }
+
+    return bounds;
+}
+
+void SceneBvh::update(const SdfProgram &program, const bool separate_static) {
+    std::vector<Aabb> new_bounds = compute_group_bounds(program);
+
+    std::vector<bool> new_static(program.groups.size());
+    for (size_t i = 0; i < program.groups.size(); i++) {
+        new_static[i] = separate_static && (program.groups[i].flags & SDF_GROUP_STATIC);
+    }
+
+    const bool same_groups = std::ranges::equal(bounds, new_bounds, {}, kind, kind) && static_groups == new_static;
+    bounds = std::move(new_bounds);
+    static_groups = std::move(new_static);
+
+    if (!same_groups || num_builds == 0) {
+        build();
+        return;
+    }
+
+    refit();
+    if (cost() > max_refit_cost_ratio * built_cost) {
+        build();
+        return;
+    }
+
+    num_refits++;
+}
+
+void SceneBvh::clear() {
+    nodes.clear();
+    items.clear();
+    bounds.clear();
+    static_groups.clear();
+    num_unbounded = 0;
+    static_root = NO_NODE;
+    built_cost = 0;
+}
+
+void SceneBvh::build() {
+    nodes.clear();
+    items.clear();
+
+    for (uint32_t i = 0; i < bounds.size(); i++) {
+        if (kind(bounds[i]) == BoundKind::Infinite) items.push_back(i);
+    }
+    num_unbounded = static_cast<uint32_t>(items.size());
+
+    // Groups with empty bounds can never be hit and are left out entirely. Static groups go first.
+    for (const bool want_static: {true, false}) {
+        for (uint32_t i = 0; i < bounds.size(); i++) {
+            if (kind(bounds[i]) == BoundKind::Finite && static_groups[i] == want_static) items.push_back(i);
+        }
+    }
+
+    const auto num_bounded = static_cast<uint32_t>(items.size()) - num_unbounded;
+    const auto num_static = static_cast<uint32_t>(std::ranges::count_if(items, [&](const uint32_t i) {
+        return static_groups[i];
+    }));
+
+    static_root = NO_NODE;
+    if (num_static > 0 && num_static < num_bounded) {
+        // The root splits static from dynamic groups, whatever their positions
+        nodes.resize(3);
+        build_node(1, num_unbounded, num_static);
+        build_node(2, num_unbounded + num_static, num_bounded - num_static);
+
+        const Aabb box = Aabb{nodes[1].min, nodes[1].max}.merge({nodes[2].min, nodes[2].max});
+        nodes[0] = {box.min, 1, box.max, 0};
+        static_root = 1;
+    } else if (num_bounded > 0) {
+        nodes.emplace_back();
+        build_node(0, num_unbounded, num_bounded);
+        if (num_static > 0) static_root = 0;
+    }
+
+    built_cost = cost();
+    num_builds++;
+}
+
+void SceneBvh::build_node(const uint32_t node, const uint32_t first, const uint32_t count) {
+    Aabb box = Aabb::empty();
+    Aabb centroids = Aabb::empty();
+    for (uint32_t i = first; i < first + count; i++) {
+        const Aabb &item = bounds[items[i]];
+        box = box.merge(item);
+        centroids = centroids.merge({item.center(), item.center()});
+    }
+
+    if (count <= MAX_LEAF_SIZE) {
+        // In group order, so the shader walks the leaf run by run
+        std::sort(items.begin() + first, items.begin() + first + count);
+        nodes[node] = {box.min, first, box.max, count};
+        return;
+    }
+
+    // Median split along the longest axis of the centroids
+    const glm::vec3 extent = centroids.max - centroids.min;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    const uint32_t half = count / 2;
+    const auto begin = items.begin() + first;
+    std::nth_element(begin, begin + half, begin + count, [&](const uint32_t a, const uint32_t b) {
+        return bounds[a].center()[axis] < bounds[b].center()[axis];
+    });
+
+    const auto children = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[node] = {box.min, children, box.max, 0};
+
+    build_node(children, first, half);
+    build_node(children + 1, first + half, count - half);
+}
+
+void SceneBvh::refit() {
+    // Children are always stored after their parent
+    for (size_t n = nodes.size(); n-- > 0;) {
+        BvhNode &node = nodes[n];
+        Aabb box = Aabb::empty();
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) box = box.merge(bounds[items[i]]);
+        } else {
+            for (uint32_t c = node.first; c < node.first + 2; c++) box = box.merge({nodes[c].min, nodes[c].max});
+        }
+
+        node.min = box.min;
+        node.max = box.max;
+    }
+}
+
+float SceneBvh::cost() const {
+    float total = 0;
+    for (const BvhNode &node: nodes) total += Aabb{node.min, node.max}.surface_area();
+    return total;
+}
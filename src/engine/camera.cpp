@@ -10,6 +10,12 @@ void Camera::rotate(const float x_offset, const float y_offset) {
     update_vectors();
 }
 
+void Camera::set_rotation(const float new_yaw, const float new_pitch) {
+    yaw = new_yaw;
+    pitch = new_pitch;
+    update_vectors();
+}
+
 void Camera::update_vectors() {
     front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
     front.y = sin(glm::radians(pitch));
@@ -0,0 +1,91 @@
+#include <engine/cone_prepass.h>
+#include <utils/algo.h>
+
+#include <array>
+
+namespace {
+    // Layout of the StepCountBuffer in the shader
+    constexpr size_t num_step_counters = 2;
+}
+
+Err ConePrepass::init() {
+    glGenTextures(1, &depth_id);
+    glBindTexture(GL_TEXTURE_2D, depth_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &steps_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, steps_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, num_step_counters * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create the cone pre-pass resources. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+Err ConePrepass::execute(const compute::ComputeShader &raymarcher, const uint32_t width, const uint32_t height,
+                         const uint32_t group_size, const bool defer_baseline) {
+    read_stats();
+
+    measuring = !stats_fence.pending();
+    const bool baseline_due = num_measurements % BASELINE_INTERVAL == BASELINE_INTERVAL - 1;
+    const bool baseline = measuring && baseline_due && !defer_baseline;
+    if (measuring) {
+        // A deferred baseline stays due
+        if (!baseline_due || baseline) num_measurements++;
+        num_pixels = width * height;
+        glClearNamedBufferData(steps_id, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STEPS_BINDING, steps_id);
+    raymarcher.bind("count_steps", (GLboolean) measuring);
+
+    ran_cones = enabled && !baseline;
+    raymarcher.bind("use_cone_depth", (GLboolean) ran_cones);
+    if (!ran_cones) return {};
+
+    const glm::uvec2 cells(ceil_divide(width, CELL_SIZE), ceil_divide(height, CELL_SIZE));
+    if (cells != depth_size) {
+        depth_size = cells;
+        glBindTexture(GL_TEXTURE_2D, depth_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, cells.x, cells.y, 0, GL_RED, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glBindImageTexture(DEPTH_UNIT, depth_id, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+
+    Err err;
+    raymarcher.bind("cone_pass", (GLboolean) true);
+    raymarcher.bind("cone_cell_size", CELL_SIZE);
+    if ((err = raymarcher.execute(ceil_divide(cells.x, group_size), ceil_divide(cells.y, group_size), 1))) return err;
+    raymarcher.bind("cone_pass", (GLboolean) false);
+
+    // The full resolution pass starts from the depths
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    return {};
+}
+
+void ConePrepass::end_frame() {
+    if (!measuring) return;
+
+    stats_fence.signal();
+    measured_cones = ran_cones;
+    measuring = false;
+}
+
+void ConePrepass::read_stats() {
+    if (!stats_fence.poll()) return;
+
+    std::array<uint32_t, num_step_counters> counts{};
+    glGetNamedBufferSubData(steps_id, 0, sizeof(counts), counts.data());
+    if (num_pixels == 0) return;
+
+    const float steps = static_cast<float>(counts[0]) / static_cast<float>(num_pixels);
+    if (!measured_cones) {
+        last_stats.baseline_steps_per_pixel = steps;
+        return;
+    }
+
+    last_stats.steps_per_pixel = steps;
+    last_stats.cone_steps_per_pixel = static_cast<float>(counts[1]) / static_cast<float>(num_pixels);
+}
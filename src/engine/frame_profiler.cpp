@@ -0,0 +1,156 @@
+#include <engine/frame_profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+FrameProfiler::ScopedTimer::ScopedTimer(FrameProfiler &profiler, const CpuPass pass)
+        : profiler(profiler), pass(pass), start(std::chrono::steady_clock::now()) {
+
+}
+
+FrameProfiler::ScopedTimer::~ScopedTimer() {
+    profiler.add_cpu(pass, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+Err FrameProfiler::init() {
+    for (QuerySlot &slot: slots) {
+        for (std::array<GLuint, 2> &ids: slot.query_ids) glGenQueries(static_cast<GLsizei>(ids.size()), ids.data());
+    }
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create the frame profiler's queries. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+void FrameProfiler::begin_frame() {
+    const auto now = std::chrono::steady_clock::now();
+    if (started) {
+        times_of(current).cpu[static_cast<size_t>(CpuPass::Frame)] =
+                std::chrono::duration<float, std::milli>(now - frame_start).count();
+        current++;
+    }
+    started = true;
+    frame_start = now;
+
+    for (QuerySlot &slot: slots) {
+        if (slot.pending) read_slot(slot);
+    }
+
+    // Reissuing the queries discards the results they are still waiting for
+    QuerySlot &slot = current_slot();
+    if (slot.pending) num_lost++;
+    slot.pending = false;
+    slot.frame = current;
+    slot.issued.fill(false);
+
+    FrameTimes &times = times_of(current);
+    times.frame = current;
+    times.gpu.fill(-1);
+    times.cpu.fill(-1);
+}
+
+void FrameProfiler::end_frame() {
+    QuerySlot &slot = current_slot();
+    slot.pending = std::ranges::any_of(slot.issued, [](const bool issued) { return issued; });
+}
+
+void FrameProfiler::begin_gpu(const GpuPass pass) {
+    QuerySlot &slot = current_slot();
+    const auto p = static_cast<size_t>(pass);
+    glQueryCounter(slot.query_ids[p][0], GL_TIMESTAMP);
+}
+
+void FrameProfiler::end_gpu(const GpuPass pass) {
+    QuerySlot &slot = current_slot();
+    const auto p = static_cast<size_t>(pass);
+    glQueryCounter(slot.query_ids[p][1], GL_TIMESTAMP);
+    slot.issued[p] = true;
+}
+
+void FrameProfiler::add_cpu(const CpuPass pass, const float ms) {
+    float &time = times_of(current).cpu[static_cast<size_t>(pass)];
+    time = std::max(time, 0.0f) + ms;
+}
+
+void FrameProfiler::read_slot(QuerySlot &slot) {
+    for (size_t p = 0; p < NUM_GPU_PASSES; p++) {
+        if (!slot.issued[p]) continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(slot.query_ids[p][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+    slot.pending = false;
+
+    // Fell out of the history while in flight
+    if (slot.frame < first_frame()) return;
+
+    FrameTimes &times = times_of(slot.frame);
+    for (size_t p = 0; p < NUM_GPU_PASSES; p++) {
+        if (!slot.issued[p]) continue;
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(slot.query_ids[p][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.query_ids[p][1], GL_QUERY_RESULT, &end);
+        times.gpu[p] = static_cast<float>(end - begin) / 1e6f;
+    }
+}
+
+template<typename F>
+std::vector<float> FrameProfiler::finished_times(F &&time) const {
+    std::vector<float> times;
+    for (uint64_t frame = first_frame(); frame < current; frame++) {
+        const float t = time(history[frame % HISTORY]);
+        if (t >= 0) times.push_back(t);
+    }
+    return times;
+}
+
+std::vector<float> FrameProfiler::gpu_times(const GpuPass pass) const {
+    return finished_times([&](const FrameTimes &times) { return times.gpu[static_cast<size_t>(pass)]; });
+}
+
+std::vector<float> FrameProfiler::cpu_times(const CpuPass pass) const {
+    return finished_times([&](const FrameTimes &times) { return times.cpu[static_cast<size_t>(pass)]; });
+}
+
+FrameProfiler::Percentiles FrameProfiler::percentiles(std::vector<float> times) {
+    if (times.empty()) return {};
+    std::ranges::sort(times);
+
+    // Nearest rank
+    const auto at = [&](const float p) {
+        const auto rank = static_cast<size_t>(std::ceil(p * static_cast<float>(times.size())));
+        return times[std::clamp<size_t>(rank, 1, times.size()) - 1];
+    };
+    return {at(0.5f), at(0.95f), at(0.99f), times.back()};
+}
+
+Err FrameProfiler::export_csv(const std::filesystem::path &path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) return Err("Failed to open {} for the frame profile.", path.string());
+
+    file << "frame";
+    for (const std::string_view name: GPU_PASS_NAMES) file << ",gpu " << name << " ms";
+    for (const std::string_view name: CPU_PASS_NAMES) file << ",cpu " << name << " ms";
+    file << '\n';
+
+    const auto write_time = [&](const float time) {
+        file << ',';
+        if (time >= 0) file << time;
+    };
+
+    for (uint64_t frame = first_frame(); frame < current; frame++) {
+        const FrameTimes &times = history[frame % HISTORY];
+        file << times.frame;
+        for (const float time: times.gpu) write_time(time);
+        for (const float time: times.cpu) write_time(time);
+        file << '\n';
+    }
+
+    if (file.fail()) return Err("Failed to write the frame profile to {}.", path.string());
+    return {};
+}
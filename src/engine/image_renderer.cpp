@@ -1,7 +1,12 @@
 #include <engine/image_renderer.h>
+#include <compute/program_cache.h>
 
+#include <algorithm>
 #include <cstring>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <string>
 
 const char *vertex_shader_code = "#version 460\n"
                                  "layout (location = 0) in vec3 aPos;\n"
@@ -32,11 +37,12 @@ const char *frag_shader_code = "#version 460\n"
                                "    FragColor = texture(texture1, TexCoord);\n"
                                "}\0";
 
-ImageRenderer::ImageRenderer(const GLuint width, const GLuint height) : width(width), height(height) {
+ImageRenderer::ImageRenderer(const GLuint width, const GLuint height) : width(width), height(height),
+                                                                       render_width(width), render_height(height) {
 
 }
 
-Err ImageRenderer::init() {
+Err ImageRenderer::build_program() {
     GLint success;
     std::array<char, 1024> error_info{};
 
@@ -66,10 +72,10 @@ Err ImageRenderer::init() {
         return Err("Error compiling fragment shader source code. \n{}", error_info.data());
     }
 
-    // Create shader program
-    program_id = glCreateProgram();
+    // Link shader program
     glAttachShader(program_id, vertex_shader_id);
     glAttachShader(program_id, fragment_shader_id);
+    glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program_id);
 
     glGetProgramiv(program_id, GL_LINK_STATUS, &success);
@@ -81,6 +87,25 @@ Err ImageRenderer::init() {
     glDeleteShader(vertex_shader_id);
     glDeleteShader(fragment_shader_id);
 
+    return {};
+}
+
+Err ImageRenderer::init() {
+    program_id = glCreateProgram();
+    if (!program_id) return Err("Failed to create shader program.");
+
+    const std::string sources = std::string(vertex_shader_code) + frag_shader_code;
+    if (!compute::load_program_binary(program_id, sources)) {
+        const auto start = std::chrono::steady_clock::now();
+
+        Err err;
+        if ((err = build_program())) return err;
+        if ((err = compute::store_program_binary(program_id, sources))) err.print();
+
+        compute::record_program_compile(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
     // Generate and populate vertex buffer
     constexpr float vertices[] = {
             // positions          // colors           // texture coords
@@ -148,4 +173,23 @@ void ImageRenderer::draw() const {
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 }
 
+void ImageRenderer::set_render_scale(const float scale) {
+    const auto scaled = [&](const GLuint size) {
+        return std::clamp(static_cast<GLuint>(std::lround(static_cast<float>(size) * scale)), 1u, size);
+    };
+    render_width = scaled(width);
+    render_height = scaled(height);
+}
+
+Err ImageRenderer::read_image(Image &image) const {
+    image.resize(render_width, render_height);
 
+    glGetTextureSubImage(texture_id, 0, 0, 0, 0, render_width, render_height, 1, GL_RGBA, GL_FLOAT,
+                         static_cast<GLsizei>(image.pixels.size() * sizeof(glm::vec4)), image.pixels.data());
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to read back raymarched image. GL error {}.", gl_err);
+    }
+
+    return {};
+}
@@ -0,0 +1,66 @@
+#include <engine/march_stats.h>
+
+#include <vector>
+
+namespace {
+    // Layout of the MarchStatsBuffer in the shader, every counter is a low and a high word
+    enum Counter : uint32_t {
+        MarchSteps, ShadowSteps, SdfEvals, Hits, Misses, Exhausted, NumCounters
+    };
+
+    constexpr size_t num_counter_words = 2 * (NumCounters + MarchStats::HISTOGRAM_BINS);
+}
+
+Err MarchStats::init() {
+    for (Readback &readback: readbacks.slots) {
+        glCreateBuffers(1, &readback.buffer_id);
+        glNamedBufferStorage(readback.buffer_id, num_counter_words * sizeof(uint32_t), nullptr,
+                             GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create the march statistics buffers. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+void MarchStats::begin_frame(const compute::ComputeShader &raymarcher) {
+    read_stats();
+
+    counting = enabled ? readbacks.begin_frame() : nullptr;
+    raymarcher.bind("count_march_stats", (GLboolean) (counting != nullptr));
+    if (!counting) return;
+
+    glClearNamedBufferData(counting->buffer_id, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, counting->buffer_id);
+}
+
+void MarchStats::end_frame() {
+    if (!counting) return;
+
+    readbacks.end_frame();
+    counting = nullptr;
+}
+
+void MarchStats::read_stats() {
+    readbacks.read_finished([&](const Readback &readback) {
+        std::vector<uint32_t> words(num_counter_words);
+        glGetNamedBufferSubData(readback.buffer_id, 0, static_cast<GLsizeiptr>(words.size() * sizeof(uint32_t)),
+                                words.data());
+        const auto counter = [&](const uint32_t idx) {
+            return static_cast<uint64_t>(words[2 * idx + 1]) << 32 | words[2 * idx];
+        };
+
+        last_stats.march_steps = counter(MarchSteps);
+        last_stats.shadow_steps = counter(ShadowSteps);
+        last_stats.sdf_evals = counter(SdfEvals);
+        last_stats.num_hits = counter(Hits);
+        last_stats.num_misses = counter(Misses);
+        last_stats.num_exhausted = counter(Exhausted);
+        last_stats.num_pixels = last_stats.num_hits + last_stats.num_misses;
+        for (uint32_t bin = 0; bin < HISTOGRAM_BINS; bin++) {
+            last_stats.step_histogram[bin] = counter(NumCounters + bin);
+        }
+        last_stats.num_counted_frames++;
+    });
+}
@@ -12,8 +12,10 @@ Object::write_to_compute_buffer_impl(compute::ComputeBuffer &buf, const glm::vec
     const glm::vec3 global_pos = pos;
     const glm::vec3 global_scale = scale;
 
-    const GLuint num_children = children.size();
-    if ((err = buf.write(obj_type, global_pos, global_scale, color, diffuse, specular, link_type, num_children)))
+    ObjectRecord record = to_record();
+    record.pos = global_pos;
+    record.scale = global_scale;
+    if ((err = buf.write(record)))
         return err;
 
     size_t num_total_objects = 1;
@@ -27,6 +29,32 @@ Object::write_to_compute_buffer_impl(compute::ComputeBuffer &buf, const glm::vec
     return num_total_objects;
 }
 
+size_t Object::write_to_records(std::vector<ObjectRecord> &records) const {
+    records.push_back(to_record());
+
+    size_t num_total_objects = 1;
+    for (const Object &child: children) {
+        num_total_objects += child.write_to_records(records);
+    }
+
+    return num_total_objects;
+}
+
+bool Object::clear_dirty() {
+    bool was_dirty = dirty;
+    dirty = false;
+
+    for (Object &child: children) {
+        was_dirty = child.clear_dirty() || was_dirty;
+    }
+    return was_dirty;
+}
+
+ObjectRecord Object::to_record() const {
+    return ObjectRecord{obj_type, pos, scale, color, diffuse, specular, link_type,
+                        static_cast<uint32_t>(children.size())};
+}
+
 Object::Object(const std::string &name, ObjectType objType, const glm::vec3 &pos, const glm::vec3 &scale,
                const glm::vec3 &color) : name(name),
                                          obj_type(
@@ -39,7 +67,7 @@ Object::Object(const std::string &name, ObjectType objType, const glm::vec3 &pos
 
 Err Object::write_to_buffer(Buffer &buffer) const {
     Err err;
-    if ((err = buffer.write(name, obj_type, pos, scale, color, diffuse, specular, link_type))) return err;
+    if ((err = buffer.write(name, obj_type, pos, scale, color, diffuse, specular, link_type, is_static))) return err;
 
     const uint16_t num_children = children.size();
     if ((err = buffer.write(num_children))) return err;
@@ -51,10 +79,11 @@ Err Object::write_to_buffer(Buffer &buffer) const {
     return err;
 }
 
-Err Object::read_from_buffer(Buffer &buffer) {
+Err Object::read_from_buffer(Buffer &buffer, const uint32_t version) {
     Err err;
 
     if ((err = buffer.read(name, obj_type, pos, scale, color, diffuse, specular, link_type))) return err;
+    if (version >= 1 && (err = buffer.read(is_static))) return err;
 
     uint16_t num_children;
     if ((err = buffer.read(num_children))) return err;
@@ -62,7 +91,7 @@ Err Object::read_from_buffer(Buffer &buffer) {
     children.reserve(num_children);
     for (uint16_t i = 0; i < num_children; ++i) {
         Object object;
-        if ((err = object.read_from_buffer(buffer))) return err;
+        if ((err = object.read_from_buffer(buffer, version))) return err;
 
         children.emplace_back(std::move(object));
     }
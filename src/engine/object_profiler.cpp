@@ -0,0 +1,97 @@
+#include <engine/object_profiler.h>
+
+#include <algorithm>
+
+Err ObjectProfiler::init() {
+    for (Readback &readback: readbacks.slots) glCreateBuffers(1, &readback.buffer_id);
+    glCreateBuffers(1, &heat_id);
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create the object profiler's buffers. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+void ObjectProfiler::begin_frame(const compute::ComputeShader &raymarcher, const SdfProgram &program,
+                                 const bool profiling_shader) {
+    read_stats();
+    if (!profiling_shader) return;
+
+    counting = program.objects.empty() ? nullptr : readbacks.begin_frame();
+    raymarcher.bind("count_object_costs", (GLboolean) (counting != nullptr));
+    raymarcher.bind("show_cost_heat", (GLboolean) (show_heat && !program.groups.empty()));
+
+    if (show_heat) upload_heat(program);
+    if (!counting) return;
+
+    Readback &readback = *counting;
+    const size_t size = program.objects.size() * WORDS_PER_OBJECT * sizeof(uint32_t);
+    if (size > readback.capacity) {
+        readback.capacity = std::max(size, readback.capacity * 2);
+        glNamedBufferData(readback.buffer_id, static_cast<GLsizeiptr>(readback.capacity), nullptr, GL_DYNAMIC_READ);
+    }
+    glClearNamedBufferSubData(readback.buffer_id, GL_R32UI, 0, static_cast<GLsizeiptr>(size), GL_RED_INTEGER,
+                              GL_UNSIGNED_INT, nullptr);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COSTS_BINDING, readback.buffer_id, 0, static_cast<GLsizeiptr>(size));
+    readback.object_ids = program.object_ids;
+}
+
+void ObjectProfiler::end_frame() {
+    if (!counting) return;
+
+    readbacks.end_frame();
+    counting = nullptr;
+}
+
+void ObjectProfiler::read_stats() {
+    readbacks.read_finished([&](const Readback &readback) {
+        const size_t num_objects = readback.object_ids.size();
+        std::vector<uint32_t> words(num_objects * WORDS_PER_OBJECT);
+        glGetNamedBufferSubData(readback.buffer_id, 0, static_cast<GLsizeiptr>(words.size() * sizeof(uint32_t)),
+                                words.data());
+
+        // Evaluations, then the cycles' low and high word
+        Stats stats;
+        stats.num_profiled_frames = last_stats.num_profiled_frames + 1;
+        stats.costs.resize(num_objects);
+        for (size_t obj = 0; obj < num_objects; obj++) {
+            const uint32_t *cost = &words[obj * WORDS_PER_OBJECT];
+            stats.costs[obj] = {readback.object_ids[obj], cost[0], static_cast<uint64_t>(cost[2]) << 32 | cost[1]};
+            stats.total_evals += stats.costs[obj].sdf_evals;
+            stats.total_cycles += stats.costs[obj].cycles;
+        }
+
+        object_cost.clear();
+        for (const ObjectCost &cost: stats.costs) {
+            object_cost[cost.object_id] += stats.total_cycles > 0 ? cost.cycles : cost.sdf_evals;
+        }
+        last_stats = std::move(stats);
+    });
+}
+
+void ObjectProfiler::upload_heat(const SdfProgram &program) {
+    // A group costs what its objects cost, objects added since the last profiled frame count as free
+    group_heat.assign(program.groups.size(), 0.0f);
+    for (size_t g = 0; g < program.groups.size(); g++) {
+        const SdfGroup &group = program.groups[g];
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+            if (inst.op != SdfOp::Eval) continue;
+
+            const auto it = object_cost.find(program.object_ids[inst.arg]);
+            if (it != object_cost.end()) group_heat[g] += static_cast<float>(it->second);
+        }
+    }
+
+    if (group_heat.empty()) return;
+    const float max_heat = std::ranges::max(group_heat);
+    for (float &heat: group_heat) heat = max_heat > 0 ? heat / max_heat : 0;
+
+    const size_t size = group_heat.size() * sizeof(float);
+    if (size > heat_capacity) {
+        heat_capacity = std::max(size, heat_capacity * 2);
+        glNamedBufferData(heat_id, static_cast<GLsizeiptr>(heat_capacity), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glNamedBufferSubData(heat_id, 0, static_cast<GLsizeiptr>(size), group_heat.data());
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, HEAT_BINDING, heat_id, 0, static_cast<GLsizeiptr>(size));
+}
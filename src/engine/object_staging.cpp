@@ -0,0 +1,44 @@
+#include <engine/object_staging.h>
+
+#include <algorithm>
+
+Err ObjectStaging::init() {
+    return timer.init();
+}
+
+void ObjectStaging::begin_frame(const compute::ComputeShader &raymarcher, const uint32_t num_objects) {
+    read_stats();
+
+    measuring = timer.ready();
+    baseline = measuring && num_measurements % BASELINE_INTERVAL == BASELINE_INTERVAL - 1;
+
+    staged = enabled && !baseline;
+    const uint32_t num_staged = std::min(num_objects, MAX_STAGED_OBJECTS);
+    raymarcher.bind("num_staged_objects", staged ? num_staged : 0u);
+
+    last_stats.num_objects = num_objects;
+    last_stats.num_staged = enabled ? num_staged : 0;
+
+    if (!measuring) return;
+    num_measurements++;
+    timer.begin();
+}
+
+void ObjectStaging::end_frame() {
+    if (!measuring) return;
+
+    timer.end();
+    measured_staged = staged;
+    measuring = false;
+}
+
+void ObjectStaging::read_stats() {
+    const std::optional<float> elapsed_ms = timer.poll_ms();
+    if (!elapsed_ms) return;
+
+    if (measured_staged) {
+        last_stats.staged_ms = *elapsed_ms;
+    } else {
+        last_stats.baseline_ms = *elapsed_ms;
+    }
+}
@@ -0,0 +1,57 @@
+#include <engine/render_on_demand.h>
+#include <utils/algo.h>
+
+namespace {
+    // FNV-1a over the bytes of every value added
+    struct Hasher {
+        uint64_t value = 14695981039346656037ull;
+
+        template<trivial_type ...T>
+        void add(const T &...vals) {
+            (add_bytes(&vals, sizeof(T)), ...);
+        }
+
+        void add_bytes(const void *data, const size_t size) {
+            const auto *bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; i++) {
+                value ^= bytes[i];
+                value *= 1099511628211ull;
+            }
+        }
+    };
+
+    // Everything besides the objects that the image depends on
+    uint64_t render_state_hash(const Scene &scene, const SceneBuffers &buffers, const ImageRenderer &renderer) {
+        Hasher hasher;
+
+        const Camera &camera = scene.camera;
+        hasher.add(camera.pos, camera.front, camera.up);
+
+        hasher.add(scene.fov, scene.fog_distance, scene.sky_bottom_color, scene.sky_top_color, scene.shadow_intensity,
+                   scene.visualize_distances, scene.relaxation, scene.relaxed_eps);
+        hasher.add(scene.light_dir, scene.light_pos, scene.light_color);
+
+        hasher.add(buffers.bake_static, buffers.baked_field.cell_size, buffers.cull_tiles,
+                   buffers.cone_prepass.enabled, buffers.object_staging.enabled, buffers.object_profiler.show_heat);
+
+        hasher.add(renderer.image_width(), renderer.image_height());
+        return hasher.value;
+    }
+}
+
+bool RenderOnDemand::should_render(const Scene &scene, const SceneBuffers &buffers, const ImageRenderer &renderer,
+                                   const bool objects_changed) {
+    const uint64_t hash = render_state_hash(scene, buffers, renderer);
+    const bool changed = !has_image || objects_changed || hash != last_hash;
+
+    has_image = true;
+    last_hash = hash;
+
+    const bool render = changed || !enabled;
+    if (render) {
+        last_stats.num_rendered++;
+    } else {
+        last_stats.num_skipped++;
+    }
+    return render;
+}
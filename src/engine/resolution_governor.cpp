@@ -0,0 +1,48 @@
+#include <engine/resolution_governor.h>
+
+#include <algorithm>
+#include <cmath>
+
+Err ResolutionGovernor::init() {
+    return timer.init();
+}
+
+void ResolutionGovernor::begin_frame() {
+    read_time();
+
+    measuring = timer.ready();
+    if (measuring) timer.begin();
+}
+
+void ResolutionGovernor::end_frame() {
+    if (!measuring) return;
+
+    timer.end();
+    measuring = false;
+}
+
+void ResolutionGovernor::read_time() {
+    const std::optional<float> gpu_ms = timer.poll_ms();
+    if (!gpu_ms) return;
+
+    last_stats.gpu_ms = *gpu_ms;
+    adjust(*gpu_ms);
+}
+
+float ResolutionGovernor::scale() const {
+    return enabled ? std::clamp(last_stats.scale, min_scale, max_scale) : max_scale;
+}
+
+void ResolutionGovernor::adjust(const float gpu_ms) {
+    const bool outside_band = gpu_ms > target_ms * (1 + hysteresis) || gpu_ms < target_ms * (1 - hysteresis);
+    if (!enabled || !outside_band || gpu_ms <= 0) return;
+
+    // The time grows with the number of pixels, which is the square of the scale. Rounded down to a step, so a
+    // frame that was too slow always shrinks.
+    const float old_scale = scale();
+    const float ideal = std::clamp(old_scale * std::sqrt(target_ms / gpu_ms), min_scale, max_scale);
+    const float new_scale = std::max(std::floor(ideal / SCALE_STEP + 1e-3f) * SCALE_STEP, min_scale);
+
+    if (new_scale != old_scale) last_stats.num_changes++;
+    last_stats.scale = new_scale;
+}
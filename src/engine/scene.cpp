@@ -1,49 +1,126 @@
 #include <engine/scene.h>
+#include <utils/trace.h>
 
+Err SceneBuffers::init(const std::filesystem::path &tile_cull_shader_path) {
+    Err err;
+    for (compute::MappedBuffer *buffer: {&objects, &program, &groups, &bvh_nodes, &bvh_items, &type_runs, &params}) {
+        if ((err = buffer->init())) return err;
+    }
+    if ((err = baked_textures.init()) || (err = cone_prepass.init()) || (err = object_staging.init()) ||
+        (err = march_stats.init()) || (err = object_profiler.init())) return err;
+    return tile_culler.init(tile_cull_shader_path);
+}
 
-Err Scene::setup_raymarcher(compute::ComputeShader &raymarcher, compute::ComputeBuffer &object_buffer,
-                            const ImageRenderer &image_renderer) const {
-    // Fill object buffer
-    object_buffer.reset();
-    const std::expected<size_t, Err> objects_write_result = root.write_to_compute_buffer(object_buffer);
+void SceneBuffers::end_frame() {
+    for (compute::MappedBuffer *buffer: {&objects, &program, &groups, &bvh_nodes, &bvh_items, &type_runs, &params}) {
+        buffer->end_frame();
+    }
+    tile_culler.end_frame();
+}
 
-    if (!objects_write_result) return objects_write_result.error();
+Err Scene::setup_raymarcher(compute::ComputeShader &raymarcher, const SdfProgram &program, SceneBuffers &buffers,
+                            const ImageRenderer &image_renderer) const {
+    TRACE_ZONE("Scene::setup_raymarcher");
+    Err err;
+    buffers.bvh.update(program, buffers.bake_static);
 
-    object_buffer.transfer_to_gpu();
-    raymarcher.bind_buffer(object_buffer, 1);
+    if (buffers.bake_static) {
+        buffers.baked_field.update(program);
+        if ((err = buffers.baked_textures.upload(buffers.baked_field))) return err;
+    }
+    const bool use_baked_field = buffers.bake_static && !buffers.baked_field.empty();
 
     const glm::mat4 view = camera.view_matrix();
-    const glm::mat4 proj = glm::perspective(glm::radians(fov),
-                                            ((float) image_renderer.image_width()) / image_renderer.image_height(),
-                                            0.1f, 100.0f);
+    const glm::mat4 proj = projection_matrix(
+            ((float) image_renderer.image_width()) / image_renderer.image_height());
     const glm::mat4 proj_inverse = glm::inverse(proj);
     const glm::mat4 view_inverse = glm::inverse(view);
 
-    raymarcher.activate();
-    raymarcher.bind("view", view_inverse);
-    raymarcher.bind("inv_proj", proj_inverse);
-    raymarcher.bind("image_width", image_renderer.image_width());
-    raymarcher.bind("image_height", image_renderer.image_height());
-
-    raymarcher.bind("num_objects", (GLuint) objects_write_result.value());
-
-    raymarcher.bind("sky_top_color", sky_top_color);
-    raymarcher.bind("sky_bottom_color", sky_bottom_color);
+    SceneParams params{};
+    params.view = view_inverse;
+    params.inv_proj = proj_inverse;
+    params.sky_bottom_color = sky_bottom_color;
+    params.fog_dist = fog_distance;
+    params.sky_top_color = sky_top_color;
+    params.shadow_intensity = shadow_intensity;
 
-    raymarcher.bind("fog_dist", fog_distance);
-    raymarcher.bind("shadow_intensity", shadow_intensity);
+    // TEMP: light. use buffer of lights in the future
+    params.light_direction = light_dir;
+    params.relaxation = relaxation;
+    params.light_pos = light_pos;
+    params.relaxed_eps = relaxed_eps;
+    params.light_color = light_color;
+    params.visualize_distances = visualize_distances;
+
+    const BakedField &baked = buffers.baked_field;
+    params.use_baked_field = use_baked_field;
+    if (use_baked_field) {
+        params.baked_origin = baked.origin;
+        params.baked_cell = baked.cell;
+        params.baked_dims = baked.dims;
+        params.baked_refine_dist = baked.refine_distance();
+        params.baked_bounds_min = baked.bounds.min;
+        params.baked_sample_margin = baked.sample_margin();
+        params.baked_bounds_max = baked.bounds.max;
+    }
+
+    params.image_width = image_renderer.image_width();
+    params.image_height = image_renderer.image_height();
+    params.num_unbounded = buffers.bvh.num_unbounded;
+    params.num_type_runs = static_cast<uint32_t>(program.type_runs.size());
+    params.num_bvh_nodes = static_cast<uint32_t>(buffers.bvh.nodes.size());
+    params.bvh_static_root = buffers.bvh.static_root;
+    params.use_tile_lists = buffers.cull_tiles;
+
+    // Only the records that changed are copied, an unchanged scene uploads nothing
+    if ((err = buffers.objects.update(program.objects)) || (err = buffers.program.update(program.code)) ||
+        (err = buffers.groups.update(program.groups)) || (err = buffers.type_runs.update(program.type_runs)) ||
+        (err = buffers.bvh_nodes.update(buffers.bvh.nodes)) || (err = buffers.bvh_items.update(buffers.bvh.items)) ||
+        (err = buffers.params.update(&params, sizeof(params))))
+        return err;
 
-    raymarcher.bind("visualize_distances", visualize_distances);
+    if (buffers.cull_tiles) {
+        if ((err = buffers.tile_culler.cull(buffers.groups, buffers.bvh.group_bounds(), view_inverse, proj_inverse,
+                                            image_renderer.image_width(), image_renderer.image_height())))
+            return err;
+    }
+
+    SceneBuffers::UploadStats &uploads = buffers.uploads;
+    uploads.frame_bytes = 0;
+    uploads.scene_bytes = 0;
+    for (const compute::MappedBuffer *buffer: {&buffers.objects, &buffers.program, &buffers.groups,
+                                               &buffers.type_runs, &buffers.bvh_nodes, &buffers.bvh_items,
+                                               &buffers.params}) {
+        uploads.frame_bytes += buffer->bytes_uploaded();
+        uploads.scene_bytes += buffer->size();
+    }
+
+    // The culler's bounds only count on frames that culled, otherwise their last upload is stale
+    if (buffers.cull_tiles) {
+        const compute::MappedBuffer &bounds = buffers.tile_culler.bounds_buffer();
+        uploads.frame_bytes += bounds.bytes_uploaded();
+        uploads.scene_bytes += bounds.size();
+    }
+    uploads.total_bytes += uploads.frame_bytes;
+    if (uploads.frame_bytes == 0) uploads.num_skipped_frames++;
 
-    // TEMP: light. use buffer of lights in the future
+    raymarcher.activate();
+    if ((err = raymarcher.bind_buffer(buffers.objects, 1)) || (err = raymarcher.bind_buffer(buffers.program, 2)) ||
+        (err = raymarcher.bind_buffer(buffers.groups, 3)) || (err = raymarcher.bind_buffer(buffers.bvh_nodes, 4)) ||
+        (err = raymarcher.bind_buffer(buffers.bvh_items, 5)) || (err = raymarcher.bind_buffer(buffers.type_runs, 10)) ||
+        (err = raymarcher.bind_buffer(buffers.params, SCENE_PARAMS_BINDING)))
+        return err;
 
-    raymarcher.bind("light_direction", light_dir);
-    raymarcher.bind("light_pos", light_pos);
-    raymarcher.bind("light_color", light_color);
+    if (buffers.cull_tiles) buffers.tile_culler.bind();
+    if (use_baked_field) buffers.baked_textures.bind();
 
     return {};
 }
 
+glm::mat4 Scene::projection_matrix(const float aspect_ratio) const {
+    return glm::perspective(glm::radians(fov), aspect_ratio, 0.1f, 100.0f);
+}
+
 void Scene::process_inputs(GLFWwindow *const window, const glm::vec2 &mouse_delta, float delta_time) {
 
     glm::vec3 translation(0);
@@ -66,18 +143,36 @@ void Scene::process_inputs(GLFWwindow *const window, const glm::vec2 &mouse_delt
 
 Err Scene::write_to_buffer(Buffer &buffer) const {
     Err err;
+    if ((err = buffer.write(SCENE_FILE_MAGIC, SCENE_FILE_VERSION))) return err;
     if ((err = buffer.write(fov, fog_distance, sky_bottom_color, sky_top_color, shadow_intensity,
                             visualize_distances, light_dir, light_pos, light_color)))
         return err;
+    if ((err = buffer.write(relaxation, relaxed_eps))) return err;
     if ((err = root.write_to_buffer(buffer))) return err;
     return err;
 }
 
 Err Scene::read_from_buffer(Buffer &buffer) {
+    TRACE_ZONE("Scene::read_from_buffer");
     Err err;
+
+    // Version 0 files start straight with the fov, whose bits never match the magic
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if ((err = buffer.read(magic))) return err;
+    if (magic == SCENE_FILE_MAGIC) {
+        if ((err = buffer.read(version))) return err;
+        if (version > SCENE_FILE_VERSION) {
+            return Err("Scene file version {} is newer than the supported version {}.", version, SCENE_FILE_VERSION);
+        }
+    } else {
+        buffer.rewind();
+    }
+
     if ((err = buffer.read(fov, fog_distance, sky_bottom_color, sky_top_color, shadow_intensity,
                            visualize_distances, light_dir, light_pos, light_color)))
         return err;
-    if ((err = root.read_from_buffer(buffer))) return err;
+    if (version >= 2 && (err = buffer.read(relaxation, relaxed_eps))) return err;
+    if ((err = root.read_from_buffer(buffer, version))) return err;
     return err;
 }
@@ -0,0 +1,110 @@
+#include <engine/sdf_program.h>
+#include <engine/bvh.h>
+
+#include <algorithm>
+
+namespace {
+    SdfOp combine_op(const LinkType link_type) {
+        switch (link_type) {
+            case LinkType::SoftUnion:
+                return SdfOp::SmoothUnion;
+            case LinkType::Subtraction:
+                return SdfOp::Subtract;
+            case LinkType::Intersection:
+                return SdfOp::Intersect;
+            default:
+                return SdfOp::Union;
+        }
+    }
+
+    Err emit(SdfProgram &program, const SdfInstruction instruction) {
+        if (instruction.arg > SdfInstruction::MAX_ARG) {
+            return Err("Scene has too many objects to address, the limit is {}.", SdfInstruction::MAX_ARG);
+        }
+
+        program.code.push_back(instruction.encode());
+        return {};
+    }
+
+    // Evaluates object into reg, then folds every child in from reg + 1
+    Err compile_node(SdfProgram &program, const Object &object, const uint32_t reg) {
+        if (reg >= SDF_MAX_REGISTERS) {
+            return Err("\"{}\" is nested deeper than the {} levels the raymarcher supports.", object.name,
+                       SDF_MAX_REGISTERS);
+        }
+        program.num_registers = std::max(program.num_registers, reg + 1);
+
+        Err err;
+        const auto object_idx = static_cast<uint32_t>(program.objects.size());
+        program.objects.push_back(object.to_record());
+        program.object_ids.push_back(object.uuid());
+        if ((err = emit(program, {SdfOp::Eval, reg, object_idx}))) return err;
+
+        for (const Object &child: object.children) {
+            if ((err = compile_node(program, child, reg + 1))) return err;
+            if ((err = emit(program, {combine_op(child.link_type), reg, reg + 1}))) return err;
+        }
+
+        return {};
+    }
+
+    // Empty objects are folders, anything else starts a group
+    void collect_top_level(const Object &object, std::vector<const Object *> &top_level) {
+        if (object.obj_type != ObjectType::Empty) {
+            top_level.push_back(&object);
+            return;
+        }
+
+        for (const Object &child: object.children) collect_top_level(child, top_level);
+    }
+
+    uint32_t run_type(const Object &object) {
+        return object.children.empty() ? static_cast<uint32_t>(object.obj_type) : SDF_RUN_PROGRAM;
+    }
+
+    Err compile_group(SdfProgram &program, const Object &object) {
+        Err err;
+        SdfGroup group{};
+        group.first_instruction = program.code.size();
+        group.material_object = program.objects.size();
+        group.flags = object.is_static ? static_cast<uint32_t>(SDF_GROUP_STATIC) : 0u;
+
+        if ((err = compile_node(program, object, 0))) return err;
+
+        group.num_instructions = program.code.size() - group.first_instruction;
+        program.groups.push_back(group);
+        return {};
+    }
+}
+
+std::expected<SdfProgram, Err> compile_scene(const Object &root) {
+    SdfProgram program;
+
+    // Stable, so groups with children keep their scene order
+    std::vector<const Object *> top_level;
+    collect_top_level(root, top_level);
+    std::stable_sort(top_level.begin(), top_level.end(), [](const Object *a, const Object *b) {
+        return run_type(*a) < run_type(*b);
+    });
+
+    for (const Object *object: top_level) {
+        const uint32_t type = run_type(*object);
+        if (program.type_runs.empty() || program.type_runs.back().type != type) {
+            program.type_runs.push_back({type, static_cast<uint32_t>(program.groups.size()), 0,
+                                         static_cast<uint32_t>(program.objects.size())});
+        }
+        program.type_runs.back().num_groups++;
+
+        if (Err err = compile_group(program, *object)) {
+            return std::unexpected(err.add("Failed to compile scene."));
+        }
+    }
+
+    // Planes and repetition cannot be baked into a bounded field, they stay analytic even when static
+    const std::vector<Aabb> bounds = compute_group_bounds(program);
+    for (size_t i = 0; i < program.groups.size(); i++) {
+        if (!bounds[i].is_finite()) program.groups[i].flags &= ~SDF_GROUP_STATIC;
+    }
+
+    return program;
+}
@@ -0,0 +1,181 @@
+#include <engine/shader_codegen.h>
+
+#include <array>
+#include <format>
+#include <string_view>
+
+namespace {
+    constexpr std::string_view query_begin_marker = "// SCENE QUERY BEGIN";
+    constexpr std::string_view query_end_marker = "// SCENE QUERY END";
+
+    // FNV-1a
+    struct Hasher {
+        uint64_t value = 14695981039346656037ull;
+
+        void add(const uint32_t word) {
+            for (int i = 0; i < 4; i++) {
+                value ^= (word >> (i * 8)) & 0xFFu;
+                value *= 1099511628211ull;
+            }
+        }
+    };
+
+    // Mirrors find_distance_to_object with the type resolved
+    std::string distance_expression(const ObjectType type) {
+        constexpr std::string_view p = "vec3(o.x, o.y, o.z) - pos";
+
+        switch (type) {
+            case ObjectType::Sphere:
+                return std::format("sdSphere({}, o.sx)", p);
+            case ObjectType::Box:
+                return std::format("sdBox({}, vec3(o.sx, o.sy, o.sz))", p);
+            case ObjectType::Torus:
+                return std::format("sdTorus({}, vec2(o.sx, o.sy))", p);
+            case ObjectType::InfiniteSpheres:
+                return std::format("sdInfiniteSpheres({}, vec3(o.sx, o.sy, o.sz))", p);
+            case ObjectType::RoundBox:
+                return std::format("sdRoundBox({}, vec3(o.sx, o.sy, o.sz), 0.1)", p);
+            case ObjectType::Octohedron:
+                return std::format("sdOctahedron({}, o.sx)", p);
+            case ObjectType::HexPrism:
+                return std::format("sdHexPrism({}, vec2(o.sx, o.sy))", p);
+            case ObjectType::GridPlane:
+                return "pos.y - o.y";
+            default:
+                return "MAX";
+        }
+    }
+
+    // Emits one group's distance as a function, colors are left to the interpreter at hits. A register holding an
+    // empty object sits at MAX distance, which makes every op against it either a no-op or a plain copy, so those are
+    // resolved here instead of in the shader.
+    void emit_group(std::string &out, const SdfProgram &program, const size_t group_idx) {
+        const SdfGroup &group = program.groups[group_idx];
+        std::array<bool, SDF_MAX_REGISTERS> empty{};
+
+        out += std::format("float query_group_{}(in vec3 pos) {{\n    Object o;\n", group_idx);
+
+        // Counted for the march statistics, the group's code always runs as a whole
+        uint32_t num_evals = 0;
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            if (SdfInstruction::decode(program.code[group.first_instruction + i]).op == SdfOp::Eval) num_evals++;
+        }
+        out += std::format("    sdf_evals += {}u;\n", num_evals);
+        for (uint32_t reg = 0; reg < program.num_registers; reg++) {
+            out += std::format("    float r{};\n", reg);
+        }
+
+        for (uint32_t i = 0; i < group.num_instructions; i++) {
+            const SdfInstruction inst = SdfInstruction::decode(program.code[group.first_instruction + i]);
+            const uint32_t dst = inst.dst;
+            const uint32_t arg = inst.arg;
+
+            if (inst.op == SdfOp::Eval) {
+                const ObjectType type = program.objects[arg].type;
+                empty[dst] = type == ObjectType::Empty;
+                out += std::format("    o = load_shape({}u);\n    r{} = {};\n", arg, dst,
+                                   distance_expression(type));
+                continue;
+            }
+
+            // Keeps dst, the op cannot change it
+            const bool keep = empty[arg] && (inst.op != SdfOp::Intersect || empty[dst]);
+            // Union-like ops against an empty dst pick arg
+            const bool copy = empty[dst] && !empty[arg] &&
+                              (inst.op == SdfOp::Union || inst.op == SdfOp::SmoothUnion);
+
+            if (keep || (empty[dst] && !copy)) continue;
+
+            if (copy) {
+                out += std::format("    r{} = r{};\n", dst, arg);
+                empty[dst] = false;
+                continue;
+            }
+
+            switch (inst.op) {
+                case SdfOp::Union:
+                    out += std::format("    r{0} = r{0} < r{1} ? r{0} : r{1};\n", dst, arg);
+                    break;
+                case SdfOp::SmoothUnion:
+                    out += std::format("    r{0} = smooth_min_dist(r{0}, r{1}, 10);\n", dst, arg);
+                    break;
+                case SdfOp::Subtract:
+                    out += std::format("    r{0} = max(-r{1}, r{0});\n", dst, arg);
+                    break;
+                case SdfOp::Intersect:
+                    if (empty[arg]) {
+                        out += std::format("    r{} = MAX;\n", dst);
+                        empty[dst] = true;
+                    } else {
+                        out += std::format("    r{0} = max(r{0}, r{1});\n", dst, arg);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        out += "    return r0;\n}\n\n";
+    }
+
+    // Calls f with the index of every group with children
+    template<typename F>
+    void for_each_program_group(const SdfProgram &program, F &&f) {
+        for (const SdfTypeRun &run: program.type_runs) {
+            if (run.type != SDF_RUN_PROGRAM) continue;
+            for (uint32_t i = run.first_group; i < run.first_group + run.num_groups; i++) f(i);
+        }
+    }
+}
+
+size_t num_specialized_instructions(const SdfProgram &program) {
+    size_t count = 0;
+    for_each_program_group(program, [&](const uint32_t i) { count += program.groups[i].num_instructions; });
+    return count;
+}
+
+uint64_t structural_hash(const SdfProgram &program) {
+    Hasher hasher;
+
+    hasher.add(static_cast<uint32_t>(program.code.size()));
+    for (const uint32_t inst: program.code) hasher.add(inst);
+
+    hasher.add(static_cast<uint32_t>(program.groups.size()));
+    for (const SdfGroup &group: program.groups) {
+        hasher.add(group.first_instruction);
+        hasher.add(group.num_instructions);
+        hasher.add(group.flags);
+    }
+
+    hasher.add(static_cast<uint32_t>(program.objects.size()));
+    for (const ObjectRecord &object: program.objects) hasher.add(static_cast<uint32_t>(object.type));
+
+    return hasher.value;
+}
+
+std::expected<std::string, Err> specialize_shader(const std::string &generic_source, const SdfProgram &program) {
+    if (const size_t num_instructions = num_specialized_instructions(program);
+            num_instructions > MAX_SPECIALIZED_INSTRUCTIONS) {
+        return std::unexpected(Err("Scene has {} instructions in groups, too many to specialize (limit {}).",
+                                   num_instructions, MAX_SPECIALIZED_INSTRUCTIONS));
+    }
+
+    const size_t begin = generic_source.find(query_begin_marker);
+    const size_t end = generic_source.find(query_end_marker);
+    if (begin == std::string::npos || end == std::string::npos || end < begin) {
+        return std::unexpected(Err("Shader source is missing the scene query markers."));
+    }
+
+    std::string generated = "// Generated for the groups with children\n";
+    for_each_program_group(program, [&](const uint32_t i) { emit_group(generated, program, i); });
+
+    generated += "float query_group_dist(in uint idx, in vec3 pos) {\n    switch (idx) {\n        default: break;\n";
+    for_each_program_group(program, [&](const uint32_t i) {
+        generated += std::format("        case {0}u: return query_group_{0}(pos);\n", i);
+    });
+    generated += "    }\n    return MAX;\n}\n";
+
+    std::string source = generic_source;
+    source.replace(begin, end - begin, generated);
+    return source;
+}
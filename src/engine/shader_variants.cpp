@@ -0,0 +1,118 @@
+#include <engine/shader_variants.h>
+#include <engine/shader_codegen.h>
+
+#include <algorithm>
+
+Err ShaderVariants::init(const std::filesystem::path &shader_path) {
+    std::expected<std::string, Err> source = compute::read_shader_source(shader_path);
+    if (!source) return source.error();
+
+    generic_source = std::move(*source);
+    return generic.init(generic_source);
+}
+
+compute::ComputeShader &ShaderVariants::select(const SdfProgram &program, const bool wait) {
+    num_selects++;
+    last_stats.specialized = false;
+    last_stats.compiling = false;
+    last_stats.profiling = false;
+
+    if (profile_objects) return select_profiling(wait);
+    const size_t num_instructions = num_specialized_instructions(program);
+    if (!specialize || num_instructions == 0 || num_instructions > MAX_SPECIALIZED_INSTRUCTIONS) return generic;
+
+    const uint64_t hash = structural_hash(program);
+    auto it = variants.find(hash);
+
+    if (it == variants.end()) {
+        if (variants.size() >= MAX_VARIANTS) evict();
+
+        it = variants.try_emplace(hash).first;
+        Variant &variant = it->second;
+
+        const std::expected<std::string, Err> source = specialize_shader(generic_source, program);
+        Err err;
+        if (!source) {
+            err = source.error();
+        } else {
+            err = variant.shader.init_async(*source);
+            last_stats.num_compiles++;
+        }
+
+        if (err) {
+            err.add("Failed to specialize shader, using the generic shader for this scene.").print();
+            variant.shader.destroy();
+            variant.failed = true;
+            last_stats.num_failures++;
+        }
+    }
+
+    Variant &variant = it->second;
+    variant.last_used = num_selects;
+
+    if (!finish_compile(variant, wait)) return generic;
+
+    last_stats.specialized = true;
+    return variant.shader;
+}
+
+compute::ComputeShader &ShaderVariants::select_profiling(const bool wait) {
+    std::optional<Variant> &variant = profiling_variants[profile_cycles ? 1 : 0];
+
+    if (!variant) {
+        variant.emplace();
+
+        // Right after the #version line, the extension directive has to come before any code
+        std::string source = generic_source;
+        const size_t version_end = source.find('\n') + 1;
+        source.insert(version_end, profile_cycles
+                                   ? "#define PROFILE_OBJECTS\n#define PROFILE_CYCLES\n"
+                                     "#extension GL_ARB_shader_clock : enable\n"
+                                   : "#define PROFILE_OBJECTS\n");
+
+        if (Err err = variant->shader.init_async(source)) {
+            err.add("Failed to create the profiling shader.").print();
+            variant->shader.destroy();
+            variant->failed = true;
+            last_stats.num_failures++;
+        } else {
+            last_stats.num_compiles++;
+        }
+    }
+
+    if (!finish_compile(*variant, wait)) return generic;
+
+    last_stats.profiling = true;
+    return variant->shader;
+}
+
+bool ShaderVariants::finish_compile(Variant &variant, const bool wait) {
+    while (!variant.ready && !variant.failed) {
+        const std::expected<bool, Err> ready = variant.shader.poll();
+        if (!ready) {
+            Err err = ready.error();
+            err.add("Failed to compile shader variant, using the generic shader.").print();
+            variant.shader.destroy();
+            variant.failed = true;
+            last_stats.num_failures++;
+            break;
+        }
+
+        variant.ready = *ready;
+        if (!wait) break;
+    }
+
+    last_stats.compiling = !variant.ready && !variant.failed;
+    return variant.ready;
+}
+
+void ShaderVariants::evict() {
+    const auto oldest = std::ranges::min_element(variants, {}, [](const auto &entry) {
+        return entry.second.last_used;
+    });
+
+    if (oldest == variants.end()) return;
+
+    oldest->second.shader.destroy();
+    variants.erase(oldest);
+}
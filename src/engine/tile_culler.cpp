@@ -0,0 +1,93 @@
+#include <engine/tile_culler.h>
+#include <utils/algo.h>
+
+#include <algorithm>
+
+Err TileCuller::init(const std::filesystem::path &shader_path) {
+    Err err;
+    if ((err = shader.init(shader_path)) || (err = group_bounds.init())) return err;
+
+    glGenBuffers(1, &counts_id);
+    glGenBuffers(1, &lists_id);
+
+    if (const GLenum gl_err = glGetError(); gl_err != GL_NO_ERROR) {
+        return Err("Failed to create tile culling buffers. GL error {}.", gl_err);
+    }
+    return {};
+}
+
+Err TileCuller::cull(const compute::MappedBuffer &groups, const std::vector<Aabb> &bounds, const glm::mat4 &view,
+                     const glm::mat4 &inv_proj, const uint32_t width, const uint32_t height) {
+    read_stats();
+
+    num_tiles = {ceil_divide(width, TILE_SIZE), ceil_divide(height, TILE_SIZE)};
+    const uint32_t total_tiles = num_tiles.x * num_tiles.y;
+    if (total_tiles > allocated_tiles) {
+        allocated_tiles = total_tiles;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counts_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, total_tiles * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lists_id);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<size_t>(total_tiles) * MAX_TILE_GROUPS * sizeof(uint32_t),
+                     nullptr, GL_DYNAMIC_COPY);
+    }
+
+    bounds_records.clear();
+    for (const Aabb &box: bounds) {
+        bounds_records.emplace_back(box.min, 0);
+        bounds_records.emplace_back(box.max, 0);
+    }
+
+    Err err;
+    if ((err = group_bounds.update(bounds_records))) return err;
+
+    shader.activate();
+    if ((err = shader.bind_buffer(groups, 3)) || (err = shader.bind_buffer(group_bounds, BOUNDS_BINDING))) return err;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, counts_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LISTS_BINDING, lists_id);
+
+    shader.bind("view", view);
+    shader.bind("inv_proj", inv_proj);
+    shader.bind("image_width", width);
+    shader.bind("image_height", height);
+    shader.bind("num_groups", static_cast<GLuint>(bounds.size()));
+
+    if ((err = shader.execute(num_tiles.x, num_tiles.y, 1))) return err;
+
+    // The raymarching shader reads the lists straight after
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (!stats_fence.pending()) {
+        stats_fence.signal();
+        counts.resize(total_tiles);
+    }
+    return {};
+}
+
+void TileCuller::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, counts_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LISTS_BINDING, lists_id);
+}
+
+void TileCuller::end_frame() {
+    group_bounds.end_frame();
+}
+
+void TileCuller::read_stats() {
+    if (!stats_fence.poll()) return;
+
+    glGetNamedBufferSubData(counts_id, 0, static_cast<GLsizeiptr>(counts.size() * sizeof(uint32_t)), counts.data());
+
+    Stats stats;
+    stats.num_tiles = static_cast<uint32_t>(counts.size());
+
+    uint64_t total_groups = 0;
+    for (const uint32_t count: counts) {
+        total_groups += count;
+        stats.max_groups = std::max(stats.max_groups, count);
+        if (count > MAX_TILE_GROUPS) stats.num_overflowing++;
+    }
+    if (!counts.empty()) stats.average_groups = static_cast<float>(total_groups) / static_cast<float>(counts.size());
+
+    last_stats = stats;
+}
@@ -1,4 +1,5 @@
 #include <utils/buf.h>
+#include <utils/trace.h>
 
 #include <cstring>
 #include <fstream>
@@ -57,6 +58,7 @@ Err Buffer::write_to_file(const std::filesystem::path &path) {
 }
 
 Err Buffer::read_from_file(const std::filesystem::path &path) {
+    TRACE_ZONE("Buffer::read_from_file");
     free_data();
 
     std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
@@ -115,3 +117,19 @@ Err Buffer::write(const std::string &val) {
 
     return {};
 }
+
+Err Buffer::write_bytes(const void *src, const size_t count) {
+    Err err;
+    if (offset + count > data_size && (err = expand(count))) {
+        return err.add("Failed to write bytes to buffer.");
+    }
+
+    memcpy(data + offset, src, count);
+    offset += count;
+
+    if (offset > length) {
+        length = offset;
+    }
+
+    return {};
+}
@@ -0,0 +1,259 @@
+#include <utils/image.h>
+#include <utils/buf.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string_view>
+
+namespace {
+    // PNG chunk lengths and checksums are big endian
+    Err write_u32_be(Buffer &buffer, const uint32_t val) {
+        const std::array<uint8_t, 4> bytes = {
+                static_cast<uint8_t>(val >> 24), static_cast<uint8_t>(val >> 16),
+                static_cast<uint8_t>(val >> 8), static_cast<uint8_t>(val)
+        };
+        return buffer.write_bytes(bytes.data(), bytes.size());
+    }
+
+    uint32_t crc32(const uint8_t *data, const size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                result[n] = c;
+            }
+            return result;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    Err write_png_chunk(Buffer &buffer, const std::string_view &type, const std::vector<uint8_t> &payload) {
+        Err err;
+        if ((err = write_u32_be(buffer, payload.size())) ||
+            (err = buffer.write_bytes(type.data(), type.size())) ||
+            (err = buffer.write_bytes(payload.data(), payload.size())))
+            return err;
+
+        uint32_t crc = crc32(reinterpret_cast<const uint8_t *>(type.data()), type.size());
+        crc = crc32(payload.data(), payload.size(), crc);
+        return write_u32_be(buffer, crc);
+    }
+
+    // EXR attributes are "name\0type\0" followed by the size of the value
+    Err write_exr_attribute(Buffer &buffer, const std::string_view &name, const std::string_view &type,
+                            const int32_t size) {
+        constexpr uint8_t terminator = 0;
+        Err err;
+        if ((err = buffer.write_bytes(name.data(), name.size())) || (err = buffer.write(terminator)) ||
+            (err = buffer.write_bytes(type.data(), type.size())) || (err = buffer.write(terminator)))
+            return err;
+        return buffer.write(size);
+    }
+}
+
+Image::Image(const uint32_t width, const uint32_t height) {
+    resize(width, height);
+}
+
+void Image::resize(const uint32_t new_width, const uint32_t new_height) {
+    width = new_width;
+    height = new_height;
+    pixels.assign(size(), glm::vec4(0, 0, 0, 1));
+}
+
+Err Image::write_to_file(const std::filesystem::path &path) const {
+    const std::filesystem::path extension = path.extension();
+
+    if (extension == ".png") return write_png(path);
+    if (extension == ".pfm") return write_pfm(path);
+    if (extension == ".exr") return write_exr(path);
+
+    return Err("Unsupported image format \"{}\". Expected .png, .pfm or .exr.", extension.string());
+}
+
+Err Image::write_png(const std::filesystem::path &path) const {
+    Err err;
+    Buffer buffer(size() * 3 + 1024);
+
+    constexpr std::array<uint8_t, 8> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if ((err = buffer.write_bytes(signature.data(), signature.size()))) return err;
+
+    // 8 bit truecolor, no interlacing
+    std::vector<uint8_t> header = {
+            static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16),
+            static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+            static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+            static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+            8, 2, 0, 0, 0
+    };
+    if ((err = write_png_chunk(buffer, "IHDR", header))) return err;
+
+    // Scanlines are top-down, each prefixed with filter type 0
+    const size_t row_size = static_cast<size_t>(width) * 3 + 1;
+    std::vector<uint8_t> raw(row_size * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t *row = raw.data() + row_size * (height - 1 - y);
+        row[0] = 0;
+        for (uint32_t x = 0; x < width; ++x) {
+            const glm::vec4 &pixel = at(x, y);
+            for (int c = 0; c < 3; ++c) {
+                row[1 + x * 3 + c] = static_cast<uint8_t>(std::clamp(pixel[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // zlib stream made of stored deflate blocks. Skips compression to keep writes cheap and dependency free.
+    constexpr size_t max_block_size = 65535;
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / max_block_size * 5 + 16);
+
+    uint32_t adler_a = 1, adler_b = 0;
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += max_block_size) {
+        const size_t block_size = std::min(max_block_size, raw.size() - offset);
+        const bool final_block = offset + block_size >= raw.size();
+
+        zlib.push_back(final_block ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(block_size));
+        zlib.push_back(static_cast<uint8_t>(block_size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~block_size));
+        zlib.push_back(static_cast<uint8_t>(~block_size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block_size);
+
+        for (size_t i = offset; i < offset + block_size; ++i) {
+            adler_a = (adler_a + raw[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+
+        if (final_block) break;
+    }
+
+    const uint32_t adler = (adler_b << 16) | adler_a;
+    zlib.push_back(static_cast<uint8_t>(adler >> 24));
+    zlib.push_back(static_cast<uint8_t>(adler >> 16));
+    zlib.push_back(static_cast<uint8_t>(adler >> 8));
+    zlib.push_back(static_cast<uint8_t>(adler));
+
+    if ((err = write_png_chunk(buffer, "IDAT", zlib)) || (err = write_png_chunk(buffer, "IEND", {}))) return err;
+
+    if ((err = buffer.write_to_file(path))) return err.add("Failed to write PNG {}.", path.string());
+    return {};
+}
+
+Err Image::write_pfm(const std::filesystem::path &path) const {
+    Err err;
+    Buffer buffer(size() * sizeof(glm::vec3) + 64);
+
+    // Negative scale marks little endian data. PFM rows are bottom-up like ours.
+    const std::string header = std::format("PF\n{} {}\n-1.0\n", width, height);
+    if ((err = buffer.write_bytes(header.data(), header.size()))) return err;
+
+    for (const glm::vec4 &pixel: pixels) {
+        if ((err = buffer.write(pixel.x, pixel.y, pixel.z))) return err;
+    }
+
+    if ((err = buffer.write_to_file(path))) return err.add("Failed to write PFM {}.", path.string());
+    return {};
+}
+
+Err Image::write_exr(const std::filesystem::path &path) const {
+    Err err;
+    Buffer buffer(size() * sizeof(glm::vec3) + height * (sizeof(uint64_t) + 8) + 1024);
+
+    constexpr int32_t magic = 20000630;
+    constexpr int32_t version = 2;
+    if ((err = buffer.write(magic, version))) return err;
+
+    // Channels must be sorted by name. Type 2 is 32 bit float.
+    constexpr int32_t pixel_type_float = 2;
+    constexpr std::array<char, 3> channels = {'B', 'G', 'R'};
+    constexpr uint8_t zero = 0;
+    constexpr int32_t sampling = 1;
+
+    const auto channels_size = static_cast<int32_t>(channels.size() * 18 + 1);
+    if ((err = write_exr_attribute(buffer, "channels", "chlist", channels_size))) return err;
+    for (const char channel: channels) {
+        if ((err = buffer.write(channel, zero, pixel_type_float, zero, zero, zero, zero, sampling, sampling)))
+            return err;
+    }
+    if ((err = buffer.write(zero))) return err;
+
+    const int32_t max_x = static_cast<int32_t>(width) - 1;
+    const int32_t max_y = static_cast<int32_t>(height) - 1;
+    constexpr int32_t origin = 0;
+    constexpr float one = 1.0f;
+    constexpr float center = 0.0f;
+
+    if ((err = write_exr_attribute(buffer, "compression", "compression", 1)) || (err = buffer.write(zero)) ||
+        (err = write_exr_attribute(buffer, "dataWindow", "box2i", 16)) ||
+        (err = buffer.write(origin, origin, max_x, max_y)) ||
+        (err = write_exr_attribute(buffer, "displayWindow", "box2i", 16)) ||
+        (err = buffer.write(origin, origin, max_x, max_y)) ||
+        (err = write_exr_attribute(buffer, "lineOrder", "lineOrder", 1)) || (err = buffer.write(zero)) ||
+        (err = write_exr_attribute(buffer, "pixelAspectRatio", "float", 4)) || (err = buffer.write(one)) ||
+        (err = write_exr_attribute(buffer, "screenWindowCenter", "v2f", 8)) || (err = buffer.write(center, center)) ||
+        (err = write_exr_attribute(buffer, "screenWindowWidth", "float", 4)) || (err = buffer.write(one)) ||
+        (err = buffer.write(zero)))
+        return err;
+
+    // One scanline per chunk. Offsets are absolute and chunks follow the offset table.
+    const uint64_t line_data_size = static_cast<uint64_t>(width) * channels.size() * sizeof(float);
+    const uint64_t chunk_size = sizeof(int32_t) * 2 + line_data_size;
+    const uint64_t first_chunk = buffer.size() + sizeof(uint64_t) * height;
+
+    for (uint32_t line = 0; line < height; ++line) {
+        if ((err = buffer.write(first_chunk + chunk_size * line))) return err;
+    }
+
+    // EXR scanlines are top-down, channels are planar within a line
+    for (uint32_t line = 0; line < height; ++line) {
+        const uint32_t y = height - 1 - line;
+        if ((err = buffer.write(static_cast<int32_t>(line), static_cast<int32_t>(line_data_size)))) return err;
+
+        for (const int c: {2, 1, 0}) {
+            for (uint32_t x = 0; x < width; ++x) {
+                if ((err = buffer.write(at(x, y)[c]))) return err;
+            }
+        }
+    }
+
+    if ((err = buffer.write_to_file(path))) return err.add("Failed to write EXR {}.", path.string());
+    return {};
+}
+
+std::expected<ImageDiff, Err> diff_images(const Image &a, const Image &b, const float tolerance) {
+    if (a.width != b.width || a.height != b.height) {
+        return std::unexpected(Err("Cannot diff a {}x{} image against a {}x{} image.",
+                                   a.width, a.height, b.width, b.height));
+    }
+
+    ImageDiff diff;
+    diff.num_pixels = a.size();
+
+    double error_sum = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const glm::vec4 delta = glm::abs(a.pixels[i] - b.pixels[i]);
+
+        // NaNs count as a full mismatch
+        float pixel_error = 0;
+        for (int c = 0; c < 3; ++c) {
+            pixel_error = std::isnan(delta[c]) ? 1.0f : std::max(pixel_error, delta[c]);
+        }
+
+        diff.max_error = std::max(diff.max_error, pixel_error);
+        error_sum += pixel_error;
+
+        if (pixel_error > tolerance) diff.num_mismatched++;
+    }
+
+    diff.mean_error = diff.num_pixels == 0 ? 0.0f : static_cast<float>(error_sum / diff.num_pixels);
+    return diff;
+}
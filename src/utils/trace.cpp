@@ -0,0 +1,159 @@
+#include <utils/trace.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    // Read while the thread may be overwriting it, so every field is a relaxed atomic and torn events are detected
+    // through num_written instead
+    struct TraceSlot {
+        std::atomic<const char *> name = nullptr;
+        std::atomic<uint64_t> begin_ns = 0;
+        std::atomic<uint64_t> end_ns = 0;
+    };
+
+    struct ThreadTrace {
+        uint32_t thread_id = 0;
+        std::string name;
+
+        std::array<TraceSlot, TRACE_RING_SIZE> events{};
+
+        // Events ever written, the ring holds the last TRACE_RING_SIZE of them
+        std::atomic<uint64_t> num_written = 0;
+    };
+
+    // Rings are never freed, so the events of exited threads can still be written
+    struct TraceRegistry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadTrace>> threads;
+    };
+
+    TraceRegistry &registry() {
+        static TraceRegistry instance;
+        return instance;
+    }
+
+    const std::chrono::steady_clock::time_point trace_start = std::chrono::steady_clock::now();
+
+    uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - trace_start).count();
+    }
+
+    // Registered on the thread's first event, the only time recording locks
+    ThreadTrace &thread_trace() {
+        thread_local ThreadTrace *trace = nullptr;
+        if (trace) return *trace;
+
+        TraceRegistry &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        auto &thread = reg.threads.emplace_back(std::make_unique<ThreadTrace>());
+        thread->thread_id = static_cast<uint32_t>(reg.threads.size());
+        trace = thread.get();
+        return *trace;
+    }
+
+    void write_json_string(std::ofstream &file, const std::string_view str) {
+        file << '"';
+        for (const char c: str) {
+            if (c == '"' || c == '\\') file << '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) file << c;
+        }
+        file << '"';
+    }
+}
+
+TraceZone::TraceZone(const char *name) : name(name), begin_ns(now_ns()) {
+
+}
+
+TraceZone::~TraceZone() {
+    const uint64_t end_ns = now_ns();
+
+    ThreadTrace &trace = thread_trace();
+    const uint64_t idx = trace.num_written.load(std::memory_order_relaxed);
+
+    // A reader that sees any of the stores below also sees num_written at idx, so it knows the slot was being
+    // overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceSlot &slot = trace.events[idx % TRACE_RING_SIZE];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    trace.num_written.store(idx + 1, std::memory_order_release);
+}
+
+void trace_thread_name(const std::string_view name) {
+    ThreadTrace &trace = thread_trace();
+    std::lock_guard lock(registry().mutex);
+    trace.name = name;
+}
+
+Err write_chrome_trace(const std::filesystem::path &path) {
+    std::ofstream file(path);
+    if (!file.is_open()) return Err("Failed to open {} for the trace.", path.string());
+
+    TraceRegistry &reg = registry();
+    std::lock_guard lock(reg.mutex);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const auto separate = [&] {
+        if (!first) file << ",\n";
+        first = false;
+    };
+
+    std::vector<TraceEvent> events;
+    for (const std::unique_ptr<ThreadTrace> &thread: reg.threads) {
+        if (!thread->name.empty()) {
+            separate();
+            file << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":)",
+                                thread->thread_id);
+            write_json_string(file, thread->name);
+            file << "}}";
+        }
+
+        // The thread keeps recording while its ring is copied. Event i shares its slot with event i + TRACE_RING_SIZE,
+        // which the thread may have started writing once num_written reached it, so those events are dropped.
+        const uint64_t end = thread->num_written.load(std::memory_order_acquire);
+        const uint64_t begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            const TraceSlot &slot = thread->events[i % TRACE_RING_SIZE];
+            events.push_back({slot.name.load(std::memory_order_relaxed), slot.begin_ns.load(std::memory_order_relaxed),
+                              slot.end_ns.load(std::memory_order_relaxed)});
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t written = thread->num_written.load(std::memory_order_relaxed);
+        const uint64_t first_intact = written >= TRACE_RING_SIZE ? written - TRACE_RING_SIZE + 1 : 0;
+        const size_t num_overwritten = std::min<size_t>(std::max(first_intact, begin) - begin, events.size());
+
+        for (size_t i = num_overwritten; i < events.size(); i++) {
+            const TraceEvent &event = events[i];
+            separate();
+            file << R"({"name":)";
+            write_json_string(file, event.name);
+            file << std::format(R"(,"ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})", thread->thread_id,
+                                static_cast<double>(event.begin_ns) / 1e3,
+                                static_cast<double>(event.end_ns - event.begin_ns) / 1e3);
+        }
+    }
+    file << "]}\n";
+
+    if (file.fail()) return Err("Failed to write the trace to {}.", path.string());
+    return {};
+}
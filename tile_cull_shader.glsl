@@ -0,0 +1,140 @@
+#version 460
+layout(local_size_x = 64) in;
+
+// One workgroup per screen tile, its threads split the groups between them. Every group whose bounds reach into
+// the tile's frustum is added to the tile's list, see tile_culler.h. Lists are in group order, so the raymarcher
+// can walk them run by run, see SdfTypeRun.
+
+// Must match TileCuller
+const uint TILE_SIZE = 32u;
+const uint MAX_TILE_GROUPS = 256u;
+
+// Set on list entries of static groups, so the raymarcher can skip them without loading the group
+const uint TILE_STATIC_BIT = 0x80000000u;
+
+// Must match raymarching_shader.glsl
+const float max_dist = 100.0;
+const float eps = 0.01;
+const uint GROUP_STATIC = 1u;
+
+struct Group {
+    uint first_instruction;
+    uint num_instructions;
+    uint material_object;
+    uint flags;
+};
+
+layout(std430, binding = 3) buffer GroupBuffer
+{
+    Group[] groups;
+} group_buffer;
+
+// Length of every tile's list. Lists longer than MAX_TILE_GROUPS keep counting but are cut off.
+layout(std430, binding = 6) buffer TileCountBuffer
+{
+    uint[] counts;
+} tile_count_buffer;
+
+// MAX_TILE_GROUPS entries per tile
+layout(std430, binding = 7) buffer TileListBuffer
+{
+    uint[] entries;
+} tile_list_buffer;
+
+// Min and max corner of every group's bounds, see compute_group_bounds
+layout(std430, binding = 8) buffer GroupBoundsBuffer
+{
+    vec4[] corners;
+} group_bounds_buffer;
+
+uniform mat4x4 view;
+uniform mat4x4 inv_proj;
+
+uniform uint image_width;
+uniform uint image_height;
+uniform uint num_groups;
+
+shared uint tile_count;
+
+// Per round of groups, how many of the groups up to each invocation's are kept
+shared uint kept_before[gl_WorkGroupSize.x];
+
+// Mirrors get_ray_direction, without normalizing
+vec3 get_direction(in vec2 pixel) {
+    const vec2 uv = pixel / vec2(image_width, image_height) * 2 - 1;
+    const vec3 dir = (inv_proj * vec4(uv, 0, 1.0)).xyz;
+    return (view * vec4(dir, 0)).xyz;
+}
+
+// Whether the bounds of group i reach into the frustum of the camera at origin bounded by the planes with normals
+bool reaches_tile(in uint i, in vec3 origin, in vec3 normals[4]) {
+    // Grown by the hit distance, rays count a group as hit that far from its surface
+    const vec3 bmin = group_bounds_buffer.corners[2 * i].xyz - eps;
+    const vec3 bmax = group_bounds_buffer.corners[2 * i + 1].xyz + eps;
+
+    // Empty bounds can never be hit, unbounded groups are in every tile
+    if (any(greaterThan(bmin, bmax))) return false;
+    if (any(isinf(bmin)) || any(isinf(bmax))) return true;
+
+    if (length(max(max(bmin - origin, origin - bmax), 0.0)) > max_dist) return false;
+
+    // Outside if the box's corner furthest along a plane's normal is still behind it
+    for (uint p = 0; p < 4; p++) {
+        const vec3 corner = mix(bmin, bmax, greaterThanEqual(normals[p], vec3(0)));
+        if (dot(normals[p], corner - origin) < 0) return false;
+    }
+    return true;
+}
+
+void main() {
+    const uint tile = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    const uint lane = gl_LocalInvocationIndex;
+
+    if (gl_LocalInvocationIndex == 0) tile_count = 0;
+    barrier();
+
+    // The tile's rays leave the camera between its corner directions, so its frustum is bounded by the four
+    // planes through the camera and neighbouring corners. Covering up to the next tile's first pixel is
+    // conservative.
+    const vec2 lo = vec2(gl_WorkGroupID.xy * TILE_SIZE);
+    const vec2 hi = lo + float(TILE_SIZE);
+    const vec3 corners[4] = vec3[](get_direction(lo), get_direction(vec2(hi.x, lo.y)), get_direction(hi),
+                                   get_direction(vec2(lo.x, hi.y)));
+    const vec3 center = corners[0] + corners[1] + corners[2] + corners[3];
+
+    vec3 normals[4];
+    for (uint i = 0; i < 4; i++) {
+        const vec3 n = cross(corners[i], corners[(i + 1) % 4]);
+        normals[i] = dot(n, center) < 0 ? -n : n;
+    }
+
+    const vec3 origin = (view * vec4(0, 0, 0, 1.0)).xyz;
+
+    // One group per invocation and round. The kept groups of a round are compacted in order with a scan.
+    for (uint base = 0; base < num_groups; base += gl_WorkGroupSize.x) {
+        const uint i = base + lane;
+        const bool keep = i < num_groups && reaches_tile(i, origin, normals);
+
+        kept_before[lane] = keep ? 1u : 0u;
+        barrier();
+        for (uint offset = 1; offset < gl_WorkGroupSize.x; offset *= 2) {
+            const uint add = lane >= offset ? kept_before[lane - offset] : 0u;
+            barrier();
+            kept_before[lane] += add;
+            barrier();
+        }
+
+        const uint slot = tile_count + kept_before[lane] - 1;
+        if (keep && slot < MAX_TILE_GROUPS) {
+            const bool is_static = (group_buffer.groups[i].flags & GROUP_STATIC) != 0u;
+            tile_list_buffer.entries[tile * MAX_TILE_GROUPS + slot] = i | (is_static ? TILE_STATIC_BIT : 0u);
+        }
+
+        // Everyone has read the count before it moves on
+        barrier();
+        if (lane == gl_WorkGroupSize.x - 1) tile_count += kept_before[lane];
+        barrier();
+    }
+
+    if (lane == 0) tile_count_buffer.counts[tile] = tile_count;
+}